@@ -0,0 +1,164 @@
+#ifndef ADXL345_H
+#define ADXL345_H
+
+#ifdef __KERNEL__
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#else
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#endif
+
+/*
+ * Enregistrement binaire renvoyé par read() en mode ADXL345_MODE_BINARY.
+ * Taille fixe de 16 octets, un read() peut en retourner plusieurs.
+ */
+struct adxl345_record {
+    __u64 timestamp_ns;   // CLOCK_MONOTONIC, en nanosecondes
+    __s16 x;              // Valeurs brutes (LSB) telles que lues dans DATAX0..DATAZ1
+    __s16 y;
+    __s16 z;
+    __u8 flags;           // ADXL345_RECORD_SCALE_MASK : échelle à l'acquisition
+    __u8 sensor;          // Index du capteur (N de /dev/adxl345-N, 0 pour /dev/adxl345)
+};
+
+/*
+ * /dev/adxl345_group : capture synchronisée de tous les capteurs. L'ouverture
+ * redémarre les FIFO de tous les capteurs ensemble ; read() retourne des
+ * struct adxl345_record de tous les capteurs entrelacés par ordre de
+ * timestamp_ns, sensor indiquant la provenance. Un seul lecteur à la fois.
+ */
+
+/*
+ * Filtre appliqué par le driver aux échantillons d'un descripteur
+ * (ADXL345_IOC_SET_FILTER), avant leur mise en file. Les autres descripteurs
+ * continuent de recevoir le flux brut. L'anneau mmap reste brut.
+ */
+struct adxl345_filter {
+    __u32 type;           // ADXL345_FILTER_*
+    __u32 factor;         // Échantillons d'entrée par sortie (1..256)
+    __u32 shift;          // Passe-bas : coefficient 1/2^shift (1..8)
+};
+
+#define ADXL345_FILTER_NONE         0
+#define ADXL345_FILTER_AVERAGE      1   // Moyenne de factor échantillons consécutifs
+#define ADXL345_FILTER_DECIMATE     2   // Un échantillon sur factor
+#define ADXL345_FILTER_LOWPASS      3   // y += (x - y) / 2^shift, une sortie sur factor
+
+#define ADXL345_FILTER_MAX_FACTOR   256
+#define ADXL345_FILTER_MAX_SHIFT    8
+
+/*
+ * Index d'échelle en vigueur quand l'échantillon a été acquis :
+ * 1 LSB = 3.9 mg << index (0 en FULL_RES, sinon 0..3 pour ±2/4/8/16 g).
+ */
+#define ADXL345_RECORD_SCALE_MASK   0x03
+
+/*
+ * Anneau partagé obtenu par mmap() sur /dev/adxl345 (offset 0).
+ * L'en-tête occupe le début de la zone, les enregistrements commencent à
+ * data_offset. Les index sont libres (non bornés) : l'entrée courante est
+ * records[index & (size - 1)].
+ *  - head n'est écrit que par le driver (producteur unique, thread d'IRQ),
+ *    publié avec une barrière release après l'écriture des données ;
+ *  - tail n'est écrit que par l'application après consommation.
+ * Quand l'anneau est plein, les nouveaux échantillons sont comptés dans
+ * dropped et perdus. poll() signale POLLIN tant que head != tail.
+ */
+struct adxl345_ring_header {
+    __u32 head;           // Index producteur
+    __u32 tail;           // Index consommateur
+    __u32 size;           // Nombre d'enregistrements (puissance de 2)
+    __u32 dropped;        // Enregistrements perdus, anneau plein
+    __u32 data_offset;    // Début des enregistrements depuis le début de la zone
+    __u32 record_size;    // sizeof(struct adxl345_record)
+};
+
+/*
+ * Événement lu sur /dev/adxl345_events. Chaque descripteur ouvert reçoit
+ * sa propre copie de tous les événements, dans sa propre file.
+ */
+struct adxl345_event {
+    __u64 timestamp_ns;   // CLOCK_MONOTONIC, en nanosecondes
+    __u8 type;            // ADXL345_EVENT_*
+    __u8 axes;            // ADXL345_EVENT_AXIS_* (source tap ou activité)
+    __u16 reserved;
+    __u32 overflow;       // Événements perdus par ce lecteur jusqu'ici
+};
+
+#define ADXL345_EVENT_SINGLE_TAP    1
+#define ADXL345_EVENT_DOUBLE_TAP    2
+#define ADXL345_EVENT_ACTIVITY      3   // axes : axes ayant dépassé le seuil
+#define ADXL345_EVENT_INACTIVITY    4
+#define ADXL345_EVENT_FREE_FALL     5
+
+/*
+ * Capture autour d'un événement tap ou activité, lue d'un bloc dans le
+ * fichier sysfs binaire capture : cet en-tête puis pre + post
+ * struct adxl345_record dans l'ordre d'acquisition. Taille de la fenêtre
+ * fixée par les fichiers sysfs capture_pre et capture_post.
+ */
+struct adxl345_capture_header {
+    __u64 timestamp_ns;   // Instant de l'événement déclencheur (CLOCK_MONOTONIC)
+    __u8 type;            // ADXL345_EVENT_SINGLE_TAP, _DOUBLE_TAP ou _ACTIVITY
+    __u8 axes;            // ADXL345_EVENT_AXIS_*
+    __u16 pre;            // Échantillons antérieurs à l'événement
+    __u16 post;           // Échantillons postérieurs
+    __u16 reserved;
+    __u32 sequence;       // Numéro de la capture, à partir de 1
+    __u32 record_size;    // sizeof(struct adxl345_record)
+};
+
+/*
+ * Offsets matériels OFSX/OFSY/OFSZ, ajoutés par le capteur à chaque
+ * échantillon : 15.6 mg par LSB, soit 4 LSB en pleine résolution.
+ * Pour conserver une calibration, sauvegarder ces valeurs et les réappliquer
+ * au démarrage (ADXL345_IOC_SET_OFFSETS, sysfs offsets ou propriété DT
+ * adi,offsets).
+ */
+struct adxl345_offsets {
+    __s8 x;
+    __s8 y;
+    __s8 z;
+    __u8 reserved;
+};
+
+#define ADXL345_EVENT_AXIS_X        (1 << 2)
+#define ADXL345_EVENT_AXIS_Y        (1 << 1)
+#define ADXL345_EVENT_AXIS_Z        (1 << 0)
+
+#define ADXL345_IOC_MAGIC       'x'
+#define ADXL345_IOC_SET_MODE    _IOW(ADXL345_IOC_MAGIC, 0, int)
+#define ADXL345_IOC_GET_MODE    _IOR(ADXL345_IOC_MAGIC, 1, int)
+#define ADXL345_IOC_RING_SIZE   _IOR(ADXL345_IOC_MAGIC, 2, int)
+// Fréquence d'échantillonnage en mHz (100 = 0.1 Hz ... 3200000 = 3200 Hz),
+// arrondie au débit matériel le plus proche
+#define ADXL345_IOC_SET_ODR     _IOW(ADXL345_IOC_MAGIC, 3, int)
+#define ADXL345_IOC_GET_ODR     _IOR(ADXL345_IOC_MAGIC, 4, int)
+// Mode basse consommation (0 ou 1), valable de 12.5 Hz à 400 Hz
+#define ADXL345_IOC_SET_LOW_POWER _IOW(ADXL345_IOC_MAGIC, 5, int)
+// Nombre d'événements perdus (file pleine) pour ce descripteur
+#define ADXL345_IOC_EVT_OVERFLOW _IOR(ADXL345_IOC_MAGIC, 6, __u32)
+// Plage de mesure en g : 2, 4, 8 ou 16
+#define ADXL345_IOC_SET_RANGE   _IOW(ADXL345_IOC_MAGIC, 7, int)
+#define ADXL345_IOC_GET_RANGE   _IOR(ADXL345_IOC_MAGIC, 8, int)
+// Résolution complète (0 ou 1) : 3.9 mg/LSB quelle que soit la plage
+#define ADXL345_IOC_SET_FULL_RES _IOW(ADXL345_IOC_MAGIC, 9, int)
+#define ADXL345_IOC_GET_FULL_RES _IOR(ADXL345_IOC_MAGIC, 10, int)
+// Filtre du descripteur (argument : pointeur sur struct adxl345_filter)
+#define ADXL345_IOC_SET_FILTER  _IOW(ADXL345_IOC_MAGIC, 11, struct adxl345_filter)
+#define ADXL345_IOC_GET_FILTER  _IOR(ADXL345_IOC_MAGIC, 12, struct adxl345_filter)
+// Calibration des offsets sur N échantillons (1..1024, 0 : 64), capteur
+// immobile, Z vers le haut. Bloque pendant la collecte.
+#define ADXL345_IOC_CALIBRATE   _IOW(ADXL345_IOC_MAGIC, 13, int)
+#define ADXL345_IOC_GET_OFFSETS _IOR(ADXL345_IOC_MAGIC, 14, struct adxl345_offsets)
+#define ADXL345_IOC_SET_OFFSETS _IOW(ADXL345_IOC_MAGIC, 15, struct adxl345_offsets)
+
+// Modes de lecture (par descripteur de fichier)
+#define ADXL345_MODE_TEXT       0
+#define ADXL345_MODE_BINARY     1
+// Texte en continu : read() bloque jusqu'aux échantillons suivants au lieu
+// de rendre EOF après une ligne (O_NONBLOCK : -EAGAIN si rien n'est prêt)
+#define ADXL345_MODE_STREAM     2
+
+#endif /* ADXL345_H */
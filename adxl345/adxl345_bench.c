@@ -0,0 +1,496 @@
+/*
+ * Author : Thomas Stäheli
+ *
+ * Banc de mesure du chemin de données de /dev/adxl345 : débit soutenu,
+ * échantillons perdus, latence de read() et âge des échantillons
+ * (percentiles), temps CPU. Fonctionne sur la carte comme avec
+ * adxl345_emul.ko sur un PC :
+ *
+ *   make adxl345_bench TOOLCHAIN=            # compilation native
+ *   ./adxl345_bench -m binary -w poll -b 1,8,32 -t 5
+ *
+ * En mode texte le driver rend une ligne puis EOF : chaque échantillon
+ * coûte un open/read/close, compté dans la latence. Le mode stream lit les
+ * mêmes lignes en continu sur un seul descripteur.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+
+#include "adxl345.h"
+
+#define MAX_BATCHES     16
+#define MAX_LATENCIES   (1 << 20)
+#define TEXT_LINE_MAX   64
+
+struct bench_config {
+    const char *device;
+    int mode;               // ADXL345_MODE_TEXT, _BINARY ou _STREAM
+    int use_poll;
+    int odr_mhz;            // 0 : ne pas changer l'ODR
+    double duration;
+    int batches[MAX_BATCHES];
+    int nb_batches;
+};
+
+struct bench_result {
+    uint64_t samples;
+    uint64_t reads;
+    uint64_t gaps;          // Échantillons manquants d'après les horodatages
+    long dropped;           // Delta de fifo_dropped (-1 si indisponible)
+    double elapsed;
+    double cpu;
+    uint64_t *read_ns;      // Durée de chaque read()
+    uint64_t *age_ns;       // Âge de chaque échantillon à sa réception
+    size_t nb_ages;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double cpu_seconds(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// Compteur fifo_dropped du capteur, via le device parent du misc
+static long read_dropped(const char *device)
+{
+    const char *name = strrchr(device, '/');
+    char path[128];
+    long val = -1;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/sys/class/misc/%s/device/fifo_dropped",
+             name ? name + 1 : device);
+    f = fopen(path, "r");
+    if (!f)
+        return -1;
+    if (fscanf(f, "%ld", &val) != 1)
+        val = -1;
+    fclose(f);
+    return val;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void print_percentiles(const char *label, uint64_t *values, size_t n)
+{
+    if (!n) {
+        printf("  %-12s -\n", label);
+        return;
+    }
+
+    qsort(values, n, sizeof(*values), cmp_u64);
+    printf("  %-12s p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n", label,
+           values[n / 2] / 1e3, values[n * 90 / 100] / 1e3,
+           values[n * 99 / 100] / 1e3, values[n - 1] / 1e3);
+}
+
+// Attend des données en mode poll, retourne 0 si prêt, non nul sinon
+static int wait_readable(int fd, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int ret;
+
+    ret = poll(&pfd, 1, timeout_ms);
+    if (ret < 0 && errno != EINTR) {
+        perror("poll");
+        return -1;
+    }
+    return ret > 0 ? 0 : 1;
+}
+
+static int open_device(const struct bench_config *cfg)
+{
+    int flags = O_RDONLY | (cfg->use_poll ? O_NONBLOCK : 0);
+    int fd;
+
+    fd = open(cfg->device, flags);
+    if (fd < 0) {
+        perror(cfg->device);
+        return -1;
+    }
+
+    if (cfg->mode != ADXL345_MODE_TEXT && ioctl(fd, ADXL345_IOC_SET_MODE, cfg->mode) < 0) {
+        perror("ADXL345_IOC_SET_MODE");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*
+ * run_binary - Lecture d'enregistrements par paquets de 'batch'
+ * L'âge d'un échantillon est l'écart entre son horodatage (CLOCK_MONOTONIC
+ * dans l'IRQ) et sa réception.
+ */
+static int run_binary(const struct bench_config *cfg, int batch, struct bench_result *res)
+{
+    struct adxl345_record *records;
+    uint64_t start, end, t0, t1, last_ts = 0, period = 0;
+    int64_t delta;
+    int odr_mhz = 0;
+    ssize_t n;
+    int fd, i;
+
+    fd = open_device(cfg);
+    if (fd < 0)
+        return -1;
+
+    if (ioctl(fd, ADXL345_IOC_GET_ODR, &odr_mhz) == 0 && odr_mhz > 0)
+        period = 1000000000000ULL / odr_mhz;
+
+    records = calloc(batch, sizeof(*records));
+    if (!records) {
+        close(fd);
+        return -1;
+    }
+
+    start = now_ns();
+    end = start + (uint64_t)(cfg->duration * 1e9);
+
+    while ((t0 = now_ns()) < end) {
+        if (cfg->use_poll && wait_readable(fd, 100))
+            continue;
+
+        t0 = now_ns();
+        n = read(fd, records, batch * sizeof(*records));
+        t1 = now_ns();
+
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            perror("read");
+            break;
+        }
+
+        if (res->reads < MAX_LATENCIES)
+            res->read_ns[res->reads] = t1 - t0;
+        res->reads++;
+
+        for (i = 0; i < n / (ssize_t)sizeof(*records); i++) {
+            // Un écart de plus de 1.5 période trahit des échantillons perdus.
+            // Écart signé : un horodatage interpolé ou recalé après un
+            // overrun peut ne pas dépasser le précédent.
+            delta = (int64_t)(records[i].timestamp_ns - last_ts);
+            if (last_ts && period && delta > (int64_t)(period * 3 / 2))
+                res->gaps += ((uint64_t)delta + period / 2) / period - 1;
+            last_ts = records[i].timestamp_ns;
+
+            if (res->nb_ages < MAX_LATENCIES)
+                res->age_ns[res->nb_ages++] = t1 - records[i].timestamp_ns;
+            res->samples++;
+        }
+    }
+
+    res->elapsed = (now_ns() - start) / 1e9;
+    free(records);
+    close(fd);
+    return 0;
+}
+
+// Mode texte : une ligne par ouverture, lue par morceaux de 'batch' octets
+static int run_text(const struct bench_config *cfg, int batch, struct bench_result *res)
+{
+    char line[TEXT_LINE_MAX];
+    uint64_t start, end, t0;
+    size_t len, chunk;
+    ssize_t n;
+    int fd;
+
+    if (batch > TEXT_LINE_MAX)
+        batch = TEXT_LINE_MAX;
+
+    start = now_ns();
+    end = start + (uint64_t)(cfg->duration * 1e9);
+
+    while ((t0 = now_ns()) < end) {
+        fd = open_device(cfg);
+        if (fd < 0)
+            return -1;
+
+        len = 0;
+        for (;;) {
+            if (cfg->use_poll && len == 0 && wait_readable(fd, 100)) {
+                if (now_ns() >= end)
+                    break;
+                continue;
+            }
+
+            chunk = sizeof(line) - len;
+            if (chunk > (size_t)batch)
+                chunk = batch;
+
+            n = read(fd, line + len, chunk);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR))
+                continue;
+            if (n <= 0)
+                break;
+            len += n;
+            if (len >= sizeof(line))
+                break;
+        }
+        close(fd);
+
+        if (len && line[len - 1] == '\n') {
+            if (res->reads < MAX_LATENCIES)
+                res->read_ns[res->reads] = now_ns() - t0;
+            res->reads++;
+            res->samples++;
+        }
+    }
+
+    res->elapsed = (now_ns() - start) / 1e9;
+    return 0;
+}
+
+/*
+ * run_stream - Lignes texte en continu, lues par morceaux de 'batch' octets
+ * Un échantillon est compté à chaque fin de ligne reçue.
+ */
+static int run_stream(const struct bench_config *cfg, int batch, struct bench_result *res)
+{
+    uint64_t start, end, t0, t1;
+    char *buf;
+    ssize_t n, i;
+    int fd;
+
+    fd = open_device(cfg);
+    if (fd < 0)
+        return -1;
+
+    buf = malloc(batch);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+
+    start = now_ns();
+    end = start + (uint64_t)(cfg->duration * 1e9);
+
+    while ((t0 = now_ns()) < end) {
+        if (cfg->use_poll && wait_readable(fd, 100))
+            continue;
+
+        t0 = now_ns();
+        n = read(fd, buf, batch);
+        t1 = now_ns();
+
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            perror("read");
+            break;
+        }
+        if (n == 0) {
+            fprintf(stderr, "EOF inattendu en mode stream\n");
+            break;
+        }
+
+        if (res->reads < MAX_LATENCIES)
+            res->read_ns[res->reads] = t1 - t0;
+        res->reads++;
+
+        for (i = 0; i < n; i++) {
+            if (buf[i] == '\n')
+                res->samples++;
+        }
+    }
+
+    res->elapsed = (now_ns() - start) / 1e9;
+    free(buf);
+    close(fd);
+    return 0;
+}
+
+static const char *mode_name(int mode)
+{
+    switch (mode) {
+    case ADXL345_MODE_BINARY:
+        return "binary";
+    case ADXL345_MODE_STREAM:
+        return "stream";
+    default:
+        return "text";
+    }
+}
+
+static int run_one(const struct bench_config *cfg, int batch)
+{
+    struct bench_result res = { 0 };
+    long dropped_before;
+    double cpu_before;
+    int ret;
+
+    res.read_ns = calloc(MAX_LATENCIES, sizeof(uint64_t));
+    res.age_ns = calloc(MAX_LATENCIES, sizeof(uint64_t));
+    if (!res.read_ns || !res.age_ns) {
+        fprintf(stderr, "Allocation impossible\n");
+        return -1;
+    }
+
+    dropped_before = read_dropped(cfg->device);
+    cpu_before = cpu_seconds();
+
+    if (cfg->mode == ADXL345_MODE_BINARY)
+        ret = run_binary(cfg, batch, &res);
+    else if (cfg->mode == ADXL345_MODE_STREAM)
+        ret = run_stream(cfg, batch, &res);
+    else
+        ret = run_text(cfg, batch, &res);
+
+    res.cpu = cpu_seconds() - cpu_before;
+    res.dropped = dropped_before < 0 ? -1 : read_dropped(cfg->device) - dropped_before;
+
+    if (ret == 0) {
+        printf("%s, %s, batch %d%s:\n",
+               mode_name(cfg->mode),
+               cfg->use_poll ? "poll" : "blocking", batch,
+               cfg->mode == ADXL345_MODE_BINARY ? " records" : " bytes");
+        printf("  samples      %llu in %.2f s (%.1f samples/s), %llu reads\n",
+               (unsigned long long)res.samples, res.elapsed,
+               res.elapsed > 0 ? res.samples / res.elapsed : 0.0,
+               (unsigned long long)res.reads);
+        if (res.dropped < 0)
+            printf("  dropped      fifo n/a, gaps %llu\n", (unsigned long long)res.gaps);
+        else
+            printf("  dropped      fifo %ld, gaps %llu\n", res.dropped, (unsigned long long)res.gaps);
+        printf("  cpu          %.3f s (%.1f %%)\n", res.cpu,
+               res.elapsed > 0 ? 100.0 * res.cpu / res.elapsed : 0.0);
+        print_percentiles("read()", res.read_ns, res.reads < MAX_LATENCIES ? res.reads : MAX_LATENCIES);
+        print_percentiles("sample age", res.age_ns, res.nb_ages);
+    }
+
+    free(res.read_ns);
+    free(res.age_ns);
+    return ret;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-d device] [-m text|stream|binary] [-w block|poll] [-b n[,n...]]\n"
+            "          [-t seconds] [-o odr_mhz]\n"
+            "  -d  device (defaut /dev/adxl345)\n"
+            "  -m  mode de lecture (defaut binary)\n"
+            "  -w  attente bloquante dans read() ou poll() + O_NONBLOCK (defaut block)\n"
+            "  -b  tailles de lot : enregistrements (binary) ou octets (text, stream), defaut 1\n"
+            "  -t  duree de chaque mesure en secondes (defaut 5)\n"
+            "  -o  ODR a programmer avant la mesure, en mHz (ex. 800000)\n",
+            prog);
+}
+
+static int parse_batches(struct bench_config *cfg, char *arg)
+{
+    char *tok;
+
+    cfg->nb_batches = 0;
+    for (tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        if (cfg->nb_batches == MAX_BATCHES || atoi(tok) <= 0)
+            return -1;
+        cfg->batches[cfg->nb_batches++] = atoi(tok);
+    }
+    return cfg->nb_batches ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_config cfg = {
+        .device = "/dev/adxl345",
+        .mode = ADXL345_MODE_BINARY,
+        .duration = 5.0,
+        .batches = { 1 },
+        .nb_batches = 1,
+    };
+    int opt, fd, i;
+
+    while ((opt = getopt(argc, argv, "d:m:w:b:t:o:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            cfg.device = optarg;
+            break;
+        case 'm':
+            if (!strcmp(optarg, "text"))
+                cfg.mode = ADXL345_MODE_TEXT;
+            else if (!strcmp(optarg, "stream"))
+                cfg.mode = ADXL345_MODE_STREAM;
+            else if (!strcmp(optarg, "binary"))
+                cfg.mode = ADXL345_MODE_BINARY;
+            else
+                goto err_usage;
+            break;
+        case 'w':
+            if (!strcmp(optarg, "poll"))
+                cfg.use_poll = 1;
+            else if (!strcmp(optarg, "block"))
+                cfg.use_poll = 0;
+            else
+                goto err_usage;
+            break;
+        case 'b':
+            if (parse_batches(&cfg, optarg))
+                goto err_usage;
+            break;
+        case 't':
+            cfg.duration = atof(optarg);
+            if (cfg.duration <= 0)
+                goto err_usage;
+            break;
+        case 'o':
+            cfg.odr_mhz = atoi(optarg);
+            break;
+        default:
+            goto err_usage;
+        }
+    }
+
+    if (cfg.odr_mhz) {
+        fd = open(cfg.device, O_RDONLY);
+        if (fd < 0) {
+            perror(cfg.device);
+            return EXIT_FAILURE;
+        }
+        if (ioctl(fd, ADXL345_IOC_SET_ODR, cfg.odr_mhz) < 0) {
+            perror("ADXL345_IOC_SET_ODR");
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        close(fd);
+    }
+
+    for (i = 0; i < cfg.nb_batches; i++) {
+        if (run_one(&cfg, cfg.batches[i]))
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+
+err_usage:
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,4571 @@
+/*
+ * Author : Thomas Stäheli
+ *
+ * Cœur du driver ADXL345, indépendant du bus. Les accès registres passent
+ * par les opérations fournies par adxl345_i2c.c ou adxl345_spi.c.
+*/
+#include <linux/module.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/uio.h>
+#include <linux/mutex.h>
+#include <linux/device.h>
+#include <linux/interrupt.h>
+#include <linux/kfifo.h>
+#include <linux/wait.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/poll.h>
+#include <linux/property.h>
+#include <linux/bitmap.h>
+#include <linux/pm_runtime.h>
+#include <linux/idr.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/kfifo_buf.h>
+#include <linux/iio/sysfs.h>
+
+#include "adxl345.h"
+#include "adxl345_core.h"
+
+#define CREATE_TRACE_POINTS
+#include "adxl345_trace.h"
+
+#define DRV_NAME "adxl345"
+#define EVT_NAME DRV_NAME "_events"
+#define GROUP_NAME DRV_NAME "_group"
+
+// Registres ADXL345
+#define ADXL345_DEVID          0x00
+#define ADXL345_DEVID_VAL      0xE5
+#define ADXL345_DATA_FORMAT    0x31
+#define ADXL345_POWER_CTL      0x2D
+#define ADXL345_DATAX0         0x32
+#define ADXL345_BW_RATE         0x2C
+#define ADXL345_THRESH_TAP      0x1D
+#define ADXL345_OFSX            0x1E
+#define ADXL345_OFSY            0x1F
+#define ADXL345_OFSZ            0x20
+#define ADXL345_DUR             0x21
+#define ADXL345_LATENT          0x22
+#define ADXL345_WINDOW          0x23
+#define ADXL345_THRESH_ACT      0x24
+#define ADXL345_THRESH_INACT    0x25
+#define ADXL345_TIME_INACT      0x26
+#define ADXL345_ACT_INACT_CTL   0x27
+#define ADXL345_THRESH_FF       0x28
+#define ADXL345_TIME_FF         0x29
+#define ADXL345_TAP_AXES        0x2A
+#define ADXL345_ACT_TAP_STATUS  0x2B
+#define ADXL345_INT_ENABLE      0x2E
+#define ADXL345_INT_MAP         0x2F
+#define ADXL345_INT_SOURCE      0x30
+#define ADXL345_FIFO_CTL        0x38
+#define ADXL345_FIFO_STATUS     0x39
+
+// Cache des registres : tout l'espace 0x00..0x39
+#define ADXL345_REG_COUNT       (ADXL345_FIFO_STATUS + 1)
+// Lectures groupées dans le thread d'IRQ : ACT_TAP_STATUS..INT_SOURCE,
+// prolongée jusqu'à DATAZ1 en mode DATA_READY
+#define ADXL345_DATA_LEN        6
+#define ADXL345_STATUS_LEN      (ADXL345_INT_SOURCE - ADXL345_ACT_TAP_STATUS + 1)
+#define ADXL345_STATUS_DATA_LEN (ADXL345_DATAX0 + ADXL345_DATA_LEN - ADXL345_ACT_TAP_STATUS)
+
+// Configuration
+#define ADXL345_RANGE_2G       0x00
+#define ADXL345_RANGE_4G       0x01
+#define ADXL345_RANGE_8G       0x02
+#define ADXL345_RANGE_16G      0x03
+#define ADXL345_RANGE_MASK     0x03
+#define ADXL345_FULL_RES       (1 << 3)
+#define ADXL345_MEASURE_MODE   0x08
+#define ADXL345_SLEEP_MODE     0x00
+
+// Bits pour INT_ENABLE/INT_SOURCE
+#define ADXL345_INT_DATA_READY  0x80
+#define ADXL345_INT_SINGLE_TAP  0x40
+#define ADXL345_INT_DOUBLE_TAP  0x20
+#define ADXL345_INT_WATERMARK   0x02
+#define ADXL345_INT_OVERRUN     0x01
+#define ADXL345_INT_ACTIVITY    0x10
+#define ADXL345_INT_INACTIVITY  0x08
+#define ADXL345_INT_FREE_FALL   0x04
+#define ADXL345_INT_TAP_MASK    (ADXL345_INT_SINGLE_TAP | ADXL345_INT_DOUBLE_TAP)
+#define ADXL345_INT_MOTION_MASK (ADXL345_INT_ACTIVITY | ADXL345_INT_INACTIVITY | ADXL345_INT_FREE_FALL)
+#define ADXL345_INT_FIFO_MASK   (ADXL345_INT_WATERMARK | ADXL345_INT_OVERRUN)
+#define ADXL345_INT_DATA_MASK   (ADXL345_INT_DATA_READY | ADXL345_INT_FIFO_MASK)
+
+// Bits pour BW_RATE
+#define ADXL345_BW_RATE_MASK    0x0F
+#define ADXL345_BW_LOW_POWER    (1 << 4)
+#define ADXL345_RATE_100HZ      0x0A  // Valeur au démarrage du capteur
+#define ADXL345_RATE_12_5HZ     0x07  // Plage du mode basse consommation
+#define ADXL345_RATE_400HZ      0x0C
+
+// Bits pour FIFO_CTL / FIFO_STATUS
+#define ADXL345_FIFO_BYPASS     (0 << 6)
+#define ADXL345_FIFO_STREAM     (2 << 6)
+#define ADXL345_FIFO_SAMPLES    0x1F
+#define ADXL345_FIFO_ENTRIES    0x3F
+
+// FIFO matérielle : 32 niveaux, watermark programmable de 1 à 31
+#define ADXL345_FIFO_DEPTH              32
+#define ADXL345_FIFO_WATERMARK_DEFAULT  16
+// File de lecture de chaque descripteur (puissance de 2), en échantillons
+#define ADXL345_RING_SIZE               512
+// Anneau partagé par mmap (puissance de 2), en nombre d'échantillons
+#define ADXL345_MMAP_RING_SIZE          4096
+#define ADXL345_MMAP_DATA_OFFSET        PAGE_SIZE
+#define ADXL345_MMAP_BYTES              (ADXL345_MMAP_DATA_OFFSET + \
+                                         ADXL345_MMAP_RING_SIZE * sizeof(struct adxl345_record))
+// Profondeur de la file d'événements de chaque lecteur (puissance de 2)
+#define ADXL345_EVENT_QUEUE_SIZE        64
+// Conversions LSB -> mg, Q10 (x1024)
+#define ADXL345_SCALE_SHIFT             10
+// Délai sans utilisateur avant la mise en standby (modifiable via
+// power/autosuspend_delay_ms)
+#define ADXL345_AUTOSUSPEND_MS          2000
+// File de chaque capteur dans une capture groupée (puissance de 2)
+#define ADXL345_GROUP_FIFO_SIZE         256
+// Nombre max de relectures de INT_SOURCE par interruption
+#define ADXL345_IRQ_MAX_LOOPS           4
+// Latence max d'une salve : le watermark effectif est réduit aux faibles ODR
+#define ADXL345_MAX_BATCH_MS            200
+// Historique de capture autour des événements (puissance de 2), en
+// échantillons : borne de capture_pre + capture_post
+#define ADXL345_CAPTURE_MAX             256
+#define ADXL345_CAPTURE_BYTES           (sizeof(struct adxl345_capture_header) + \
+                                         ADXL345_CAPTURE_MAX * sizeof(struct adxl345_record))
+// Ligne texte "X = -1.234; Y = ...", '\n' compris
+#define ADXL345_LINE_MAX                50
+
+// Recommandation fabricant dans la déclaration des axes
+#define ADXL345_SUPRESS_BIT     (1 << 3)
+
+// Bits pour TAP_AXES
+#define ADXL345_TAP_AXIS_X      (1 << 2)
+#define ADXL345_TAP_AXIS_Y      (1 << 1)
+#define ADXL345_TAP_AXIS_Z      (1 << 0)
+#define ADXL345_TAP_AXES_MASK   (ADXL345_TAP_AXIS_X | ADXL345_TAP_AXIS_Y | ADXL345_TAP_AXIS_Z)
+
+// Bits pour ACT_INACT_CTL : activité dans le quartet haut, inactivité dans le bas
+#define ADXL345_ACT_SHIFT       4
+#define ADXL345_ACT_INACT_AC    (1 << 3)   // Couplage AC (sinon DC), par quartet
+// Axes source de l'activité dans ACT_TAP_STATUS (bits 6..4)
+#define ADXL345_ACT_AXES_SHIFT  4
+
+// Unités des registres de détection de mouvement
+#define ADXL345_THRESH_UG_PER_LSB  62500   // THRESH_ACT/INACT/FF
+#define ADXL345_TIME_FF_MS_PER_LSB 5
+#define ADXL345_DUR_US_PER_LSB     625
+#define ADXL345_LATENT_US_PER_LSB  1250    // LATENT et WINDOW
+
+// Blocs contigus programmés au probe : tap..TAP_AXES, puis BW_RATE..DATA_FORMAT
+#define ADXL345_PROFILE_EVT_LEN (ADXL345_TAP_AXES - ADXL345_THRESH_TAP + 1)
+#define ADXL345_PROFILE_CTL_LEN (ADXL345_DATA_FORMAT - ADXL345_BW_RATE + 1)
+
+// Paramètres de tap sans device tree (valeurs historiques du driver)
+#define ADXL345_DEFAULT_THRESH_TAP  0x20    // 2 g
+#define ADXL345_DEFAULT_DUR         0x08    // 5 ms
+#define ADXL345_DEFAULT_LATENT      0x32    // 62.5 ms
+#define ADXL345_DEFAULT_WINDOW      0xFF    // 318.75 ms (max)
+#define ADXL345_DEFAULT_RANGE_G     4
+#define ADXL345_DEFAULT_ODR_MHZ     100000
+
+// Calibration des offsets : 1 LSB de OFSx (15.6 mg) = 4 LSB de 3.9 mg
+#define ADXL345_OFS_LEN             3
+#define ADXL345_OFS_SCALE           4
+#define ADXL345_CALIB_1G            256     // 1 g en LSB de 3.9 mg
+#define ADXL345_CALIB_MAX_SAMPLES   1024
+#define ADXL345_CALIB_DEFAULT       64
+
+// Prototypes
+// Chemin pour les sysfs : /sys/bus/i2c/devices/0-0053/... (ou /sys/bus/spi/devices/spiX.Y/...)
+static ssize_t tap_axis_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t tap_axis_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t tap_mode_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t tap_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t tap_wait_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t tap_count_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t fifo_watermark_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t fifo_watermark_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t fifo_dropped_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t data_irq_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t data_irq_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t odr_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t odr_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t odr_available_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t low_power_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t low_power_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t range_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t range_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t full_res_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t full_res_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t activity_threshold_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t activity_threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t inactivity_threshold_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t inactivity_threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t inactivity_time_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t inactivity_time_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t act_inact_axes_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t act_inact_axes_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t act_inact_coupling_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t act_inact_coupling_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t freefall_threshold_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t freefall_threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t freefall_time_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t freefall_time_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t offsets_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t offsets_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t calibrate_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t default_mode_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t capture_pre_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t capture_pre_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t capture_post_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t capture_post_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t capture_read(struct file *file, struct kobject *kobj, struct bin_attribute *attr,
+                            char *buf, loff_t off, size_t count);
+static ssize_t default_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+static ssize_t suspend_count_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t resume_count_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t suspended_ms_show(struct device *dev, struct device_attribute *attr, char *buf);
+
+// Attributs sysfs
+static DEVICE_ATTR_RW(tap_axis);
+static DEVICE_ATTR_RW(tap_mode);
+static DEVICE_ATTR_RO(tap_wait);
+static DEVICE_ATTR_RO(tap_count);
+static DEVICE_ATTR_RW(fifo_watermark);
+static DEVICE_ATTR_RO(fifo_dropped);
+static DEVICE_ATTR_RW(data_irq);
+static DEVICE_ATTR_RW(odr);
+static DEVICE_ATTR_RO(odr_available);
+static DEVICE_ATTR_RW(low_power);
+static DEVICE_ATTR_RW(range);
+static DEVICE_ATTR_RW(full_res);
+static DEVICE_ATTR_RW(activity_threshold);
+static DEVICE_ATTR_RW(inactivity_threshold);
+static DEVICE_ATTR_RW(inactivity_time);
+static DEVICE_ATTR_RW(act_inact_axes);
+static DEVICE_ATTR_RW(act_inact_coupling);
+static DEVICE_ATTR_RW(freefall_threshold);
+static DEVICE_ATTR_RW(freefall_time);
+static DEVICE_ATTR_RW(offsets);
+static DEVICE_ATTR_WO(calibrate);
+static DEVICE_ATTR_RW(default_mode);
+static DEVICE_ATTR_RW(capture_pre);
+static DEVICE_ATTR_RW(capture_post);
+static BIN_ATTR_RO(capture, ADXL345_CAPTURE_BYTES);
+static DEVICE_ATTR_RO(suspend_count);
+static DEVICE_ATTR_RO(resume_count);
+static DEVICE_ATTR_RO(suspended_ms);
+
+// Permet de regrouper toutes les fichiers sysfs qui seront crées
+static struct attribute *adxl345_attrs[] = {
+    &dev_attr_tap_axis.attr,
+    &dev_attr_tap_mode.attr,
+    &dev_attr_tap_wait.attr,
+    &dev_attr_tap_count.attr,
+    &dev_attr_fifo_watermark.attr,
+    &dev_attr_fifo_dropped.attr,
+    &dev_attr_data_irq.attr,
+    &dev_attr_odr.attr,
+    &dev_attr_odr_available.attr,
+    &dev_attr_low_power.attr,
+    &dev_attr_range.attr,
+    &dev_attr_full_res.attr,
+    &dev_attr_activity_threshold.attr,
+    &dev_attr_inactivity_threshold.attr,
+    &dev_attr_inactivity_time.attr,
+    &dev_attr_act_inact_axes.attr,
+    &dev_attr_act_inact_coupling.attr,
+    &dev_attr_freefall_threshold.attr,
+    &dev_attr_freefall_time.attr,
+    &dev_attr_offsets.attr,
+    &dev_attr_calibrate.attr,
+    &dev_attr_default_mode.attr,
+    &dev_attr_capture_pre.attr,
+    &dev_attr_capture_post.attr,
+    &dev_attr_suspend_count.attr,
+    &dev_attr_resume_count.attr,
+    &dev_attr_suspended_ms.attr,
+    NULL,
+};
+
+static struct bin_attribute *adxl345_bin_attrs[] = {
+    &bin_attr_capture,
+    NULL,
+};
+
+// Groupe contenant toutes les fonctions sysfs
+static const struct attribute_group adxl345_attr_group = {
+    .attrs = adxl345_attrs,
+    .bin_attrs = adxl345_bin_attrs,
+};
+
+struct adxl345_group_member;
+
+// File d'échantillons propre à chaque descripteur (ou membre de groupe)
+typedef STRUCT_KFIFO_PTR(struct adxl345_record) adxl345_sample_fifo;
+
+struct adxl345_data {
+    // Référence du probe plus une par descripteur ouvert : priv survit au
+    // remove tant qu'un fichier est ouvert
+    struct kref kref;
+    bool dead;                // Retiré, plus d'accès au capteur (priv->lock)
+    struct device *dev;
+    const struct adxl345_bus_ops *bus;
+    int index;                // Numéro d'instance (ida)
+    char name[16];            // adxl345, puis adxl345-N
+    char event_name[24];
+    struct list_head node;    // Dans adxl345_instances
+    struct adxl345_group_member *group_member; // Capture groupée (priv->lock)
+    struct miscdevice miscdev;
+    struct miscdevice event_miscdev;
+    struct iio_dev *indio_dev;
+    struct mutex lock;
+    int irq;
+    // Cache des registres non volatils, protégé par priv->lock
+    u8 regs[ADXL345_REG_COUNT];
+    DECLARE_BITMAP(regs_valid, ADXL345_REG_COUNT);
+    u8 int_enable;            // Copie de INT_ENABLE (tap + données)
+    // Flux d'échantillons alimenté par la FIFO matérielle
+    u8 fifo_watermark;        // Seuil de la FIFO (1..31)
+    u8 fifo_trigger;          // Seuil effectivement programmé dans FIFO_CTL
+    u64 irq_timestamp;        // Instant d'entrée dans le handler primaire
+    int irq_data;             // INT2 dédiée aux sources de données, 0 si absente
+    u64 irq_data_timestamp;   // Instant d'entrée dans le handler primaire de INT2
+    bool data_ready;          // true : FIFO bypass, une IRQ DATA_READY par échantillon
+    struct mutex read_lock;   // Sérialise les lecteurs des files d'échantillons
+    struct list_head readers; // Descripteurs ouverts (priv->lock)
+    wait_queue_head_t read_queue; // Lecteurs texte, réveillés à chaque salve
+    u64 sample_period_ns;     // Période entre deux échantillons de la FIFO
+    u8 odr_code;              // Rate code de BW_RATE
+    bool low_power;           // Bit LOW_POWER de BW_RATE
+    u32 max_odr_mhz;          // Débit soutenable par le bus
+    u8 range;                 // ADXL345_RANGE_* de DATA_FORMAT
+    bool full_res;            // Bit FULL_RES de DATA_FORMAT
+    u8 scale_idx;             // Index dans les tables d'échelle
+    // Anneau mmap : alloué au premier mmap(), un seul propriétaire à la fois
+    void *ring;
+    struct adxl345_ring_header *ring_hdr;
+    struct adxl345_record *ring_records;
+    struct adxl345_file *ring_owner; // Protégé par priv->lock
+    atomic_t fifo_dropped;
+    struct adxl345_record last_sample; // Dernier échantillon publié (priv->lock)
+    int default_mode;         // Mode de lecture des nouveaux descripteurs
+    // Capture autour des taps et de l'activité, protégée par priv->lock.
+    // Historique glissant des derniers échantillons, figé après capture_post
+    // échantillons postérieurs à l'événement.
+    struct adxl345_record *capture_hist;
+    u32 capture_head;         // Index libre dans capture_hist (non borné)
+    u16 capture_pre;          // 0 et 0 : capture désactivée
+    u16 capture_post;
+    bool capture_pending;     // Événement reçu, échantillons postérieurs attendus
+    u16 capture_seen;         // Échantillons postérieurs déjà reçus
+    struct adxl345_capture_header capture_trigger;
+    struct adxl345_capture_header *capture; // Dernière capture figée + enregistrements
+    u32 capture_seq;
+    // Variables pour sysfs
+    char tap_axis;            // 'x', 'y', 'z'
+    char tap_mode;            // 'o'=off, 's'=single, 'd'=double, 'b'=both
+    wait_queue_head_t wait_queue;
+    atomic_t tap_count;
+    // Abonnés aux événements (un par descripteur ouvert et par tap_wait)
+    struct list_head subscribers;
+    spinlock_t event_lock;    // Protège subscribers et leurs files
+    // Compteurs debugfs des transactions bus, mis à jour sous priv->lock
+    struct dentry *debugfs;
+    u64 bus_reads;
+    u64 bus_writes;
+    u64 bus_read_bytes;
+    u64 bus_write_bytes;
+    u64 bus_errors;
+    // Calibration des offsets en cours, alimentée par push_samples (priv->lock)
+    struct completion calib_done;
+    u32 calib_target;         // Échantillons à collecter, 0 hors calibration
+    u32 calib_skip;           // Échantillons acquis avant la remise à zéro
+    u32 calib_count;
+    s32 calib_sum[3];         // Sommes par axe, en LSB de 3.9 mg
+    // Référence runtime PM tenue tant qu'une détection (tap, mouvement) est armée
+    struct mutex events_pm_lock;
+    bool events_pm_ref;
+    // Statistiques runtime PM, protégées par priv->lock
+    u32 suspend_count;
+    u32 resume_count;
+    u64 suspended_ns;         // Temps cumulé en standby (périodes terminées)
+    u64 suspend_start;        // Début de la période de standby en cours
+};
+
+// File d'événements propre à un abonné
+struct adxl345_subscriber {
+    struct list_head node;
+    DECLARE_KFIFO(events, struct adxl345_event, ADXL345_EVENT_QUEUE_SIZE);
+    u32 overflow;             // Événements perdus, file pleine
+};
+
+// Débits de BW_RATE (rate code 0x0 à 0xF) en mHz
+static const u32 adxl345_odr_mhz[] = {
+    100, 200, 390, 780, 1560, 3130, 6250, 12500,
+    25000, 50000, 100000, 200000, 400000, 800000, 1600000, 3200000,
+};
+
+/*
+ * Échelles indexées par scale_idx : 3.9 mg/LSB en FULL_RES (index 0),
+ * sinon 10 bits sur la plage choisie, soit 3.9 mg << range.
+ * La conversion d'un axe se réduit à une multiplication et un décalage.
+ */
+static const u32 adxl345_scale_mg_q10[] = { 3994, 7987, 15974, 31949 };
+// Les mêmes en m/s² par LSB pour IIO (IIO_VAL_INT_PLUS_NANO)
+static const int adxl345_scale_nano[] = { 38245935, 76491870, 152983740, 305967480 };
+
+/*
+ * Capture groupée : une file par capteur, fusionnées par timestamp à la
+ * lecture. Chaque file a un seul producteur (le thread d'IRQ du capteur)
+ * et un seul consommateur (le lecteur du groupe, sous read_lock).
+ */
+struct adxl345_group_member {
+    DECLARE_KFIFO(samples, struct adxl345_record, ADXL345_GROUP_FIFO_SIZE);
+    struct adxl345_data *priv;  // NULL une fois le capteur retiré (adxl345_group_lock)
+    u64 last_ts;                // Dernier horodatage publié dans la file
+    bool detached;              // Capteur retiré : ne retient plus la fusion
+    u32 dropped;
+};
+
+struct adxl345_group {
+    struct mutex read_lock;
+    unsigned int count;
+    struct adxl345_group_member members[];
+};
+
+// Instances sondées et capture groupée en cours
+static DEFINE_IDA(adxl345_ida);
+static struct dentry *adxl345_debugfs_root;
+static LIST_HEAD(adxl345_instances);
+static DEFINE_MUTEX(adxl345_group_lock);
+static struct adxl345_group *adxl345_group_active;
+static DECLARE_WAIT_QUEUE_HEAD(adxl345_group_wait);
+
+// Données propres à chaque descripteur ouvert sur le miscdevice
+struct adxl345_file {
+    struct adxl345_data *priv;
+    int mode;                          // ADXL345_MODE_TEXT, _BINARY ou _STREAM
+    struct adxl345_record last;        // Échantillon de la ligne texte en cours
+    // Mode stream : ligne formatée pas encore entièrement copiée (read_lock)
+    char line[ADXL345_LINE_MAX];
+    u8 line_len;
+    u8 line_pos;
+    // File des modes binaire et stream : remplie par le thread d'IRQ
+    // (priv->lock), vidée par ce seul descripteur (priv->read_lock)
+    struct list_head reader_node;
+    adxl345_sample_fifo samples;
+    wait_queue_head_t wait;
+    // Filtre du descripteur, appliqué par le thread d'IRQ (priv->lock)
+    struct adxl345_filter filter;
+    s32 filter_acc[3];                 // Somme (moyenne) ou sortie Q8 (passe-bas)
+    u32 filter_count;
+    u64 filter_first_ts;
+    u8 filter_flags;                   // Échelle des échantillons accumulés
+    bool filter_primed;
+};
+
+/*
+ * adxl345_reg_volatile - Registres modifiés par le capteur lui-même
+ *
+ * Ceux-ci sont toujours lus sur le bus et jamais mis en cache. Les autres
+ * ne sont écrits que par le driver : leur valeur en cache fait foi.
+ */
+static bool adxl345_reg_volatile(u8 reg)
+{
+    switch (reg) {
+    case ADXL345_ACT_TAP_STATUS:
+    case ADXL345_INT_SOURCE:
+    case ADXL345_FIFO_STATUS:
+        return true;
+    default:
+        return reg >= ADXL345_DATAX0 && reg < ADXL345_DATAX0 + ADXL345_DATA_LEN;
+    }
+}
+
+/*
+ * adxl345_write_reg - Écrit un registre en passant par le cache
+ *
+ * L'écriture est ignorée si le registre contient déjà la valeur demandée.
+ * En cas d'erreur l'entrée est invalidée, l'état matériel étant incertain.
+ * Doit être appelée avec priv->lock (ou avant l'enregistrement de l'IRQ).
+ */
+static int adxl345_write_reg(struct adxl345_data *priv, u8 reg, u8 val)
+{
+    bool cacheable = !adxl345_reg_volatile(reg);
+    int ret;
+
+    if (cacheable && test_bit(reg, priv->regs_valid) && priv->regs[reg] == val)
+        return 0;
+
+    trace_adxl345_bus_start(priv->index, reg, 1, true, 0);
+    ret = priv->bus->write_reg(priv->dev, reg, val);
+    trace_adxl345_bus_end(priv->index, reg, 1, true, ret);
+
+    priv->bus_writes++;
+    if (ret < 0) {
+        priv->bus_errors++;
+        __clear_bit(reg, priv->regs_valid);
+        return ret;
+    }
+    priv->bus_write_bytes++;
+
+    if (cacheable) {
+        priv->regs[reg] = val;
+        __set_bit(reg, priv->regs_valid);
+    }
+
+    return 0;
+}
+
+/*
+ * adxl345_write_regs - Écriture groupée de len registres consécutifs
+ *
+ * Une seule transaction sur le bus, évitée si tout le bloc est déjà en
+ * cache avec les mêmes valeurs. Doit être appelée avec priv->lock (ou
+ * avant l'enregistrement de l'IRQ).
+ */
+static int adxl345_write_regs(struct adxl345_data *priv, u8 reg, u8 len, const u8 *buf)
+{
+    bool cached = true;
+    int ret;
+    u8 i;
+
+    for (i = 0; i < len && cached; i++) {
+        cached = !adxl345_reg_volatile(reg + i) && test_bit(reg + i, priv->regs_valid) &&
+                 priv->regs[reg + i] == buf[i];
+    }
+    if (cached)
+        return 0;
+
+    trace_adxl345_bus_start(priv->index, reg, len, true, 0);
+    ret = priv->bus->write_regs(priv->dev, reg, len, buf);
+    trace_adxl345_bus_end(priv->index, reg, len, true, ret);
+
+    priv->bus_writes++;
+    for (i = 0; i < len; i++) {
+        if (ret < 0 || adxl345_reg_volatile(reg + i)) {
+            __clear_bit(reg + i, priv->regs_valid);
+            continue;
+        }
+        priv->regs[reg + i] = buf[i];
+        __set_bit(reg + i, priv->regs_valid);
+    }
+
+    if (ret < 0) {
+        priv->bus_errors++;
+        return ret;
+    }
+    priv->bus_write_bytes += len;
+
+    return 0;
+}
+
+/*
+ * adxl345_read_regs - Lecture groupée de len registres consécutifs
+ *
+ * Une seule transaction sur le bus. Les registres non volatils de la plage
+ * rafraîchissent le cache au passage.
+ */
+static int adxl345_read_regs(struct adxl345_data *priv, u8 reg, u8 len, u8 *buf)
+{
+    int ret;
+    u8 i;
+
+    trace_adxl345_bus_start(priv->index, reg, len, false, 0);
+    ret = priv->bus->read_regs(priv->dev, reg, len, buf);
+    trace_adxl345_bus_end(priv->index, reg, len, false, ret);
+
+    priv->bus_reads++;
+    if (ret < 0) {
+        priv->bus_errors++;
+        return ret;
+    }
+    priv->bus_read_bytes += len;
+
+    for (i = 0; i < len; i++) {
+        if (adxl345_reg_volatile(reg + i))
+            continue;
+        priv->regs[reg + i] = buf[i];
+        __set_bit(reg + i, priv->regs_valid);
+    }
+
+    return 0;
+}
+
+/*
+ * adxl345_read_reg - Lit un registre, depuis le cache s'il n'est pas volatil
+ * Retourne la valeur ou un code d'erreur négatif.
+ */
+static int adxl345_read_reg(struct adxl345_data *priv, u8 reg)
+{
+    u8 val;
+    int ret;
+
+    if (!adxl345_reg_volatile(reg) && test_bit(reg, priv->regs_valid))
+        return priv->regs[reg];
+
+    ret = adxl345_read_regs(priv, reg, 1, &val);
+    return ret < 0 ? ret : val;
+}
+
+/*
+ * adxl345_write_int_enable - Remplace les bits de INT_ENABLE désignés par
+ * mask (sources tap ou sources de données) en conservant les autres.
+ * Doit être appelée avec priv->lock.
+ */
+static int adxl345_write_int_enable(struct adxl345_data *priv, u8 mask, u8 bits)
+{
+    u8 int_enable = (priv->int_enable & ~mask) | (bits & mask);
+    int ret;
+
+    ret = adxl345_write_reg(priv, ADXL345_INT_ENABLE, int_enable);
+    if (ret < 0)
+        return ret;
+
+    priv->int_enable = int_enable;
+    return 0;
+}
+
+/*
+ * adxl345_write_fifo_ctl - Programme la FIFO en mode stream avec le
+ * watermark courant, ou en bypass si les données sont signalées par
+ * DATA_READY. Doit être appelée avec priv->lock.
+ */
+static int adxl345_write_fifo_ctl(struct adxl345_data *priv)
+{
+    u32 max_batch;
+    u8 watermark;
+
+    if (priv->data_ready) {
+        priv->fifo_trigger = 1;
+        return adxl345_write_reg(priv, ADXL345_FIFO_CTL, ADXL345_FIFO_BYPASS);
+    }
+
+    // Aux faibles ODR, une salve ne doit pas durer plus de ADXL345_MAX_BATCH_MS
+    max_batch = adxl345_odr_mhz[priv->odr_code] / 1000 * ADXL345_MAX_BATCH_MS / 1000;
+    watermark = clamp_t(u32, max_batch, 1, priv->fifo_watermark);
+    priv->fifo_trigger = watermark;
+
+    return adxl345_write_reg(priv, ADXL345_FIFO_CTL,
+        ADXL345_FIFO_STREAM | (watermark & ADXL345_FIFO_SAMPLES));
+}
+
+/*
+ * adxl345_set_watermark - Change le seuil de la FIFO (1..31)
+ *
+ * En mode data_ready la FIFO est en bypass, le seuil sera appliqué au
+ * retour en stream. Doit être appelée avec priv->lock.
+ */
+static int adxl345_set_watermark(struct adxl345_data *priv, u8 watermark)
+{
+    u8 old_watermark = priv->fifo_watermark;
+    int ret;
+
+    // 0 positionnerait le watermark en permanence, 32 n'est pas codable
+    if (watermark < 1 || watermark > ADXL345_FIFO_SAMPLES)
+        return -EINVAL;
+
+    priv->fifo_watermark = watermark;
+    ret = priv->data_ready ? 0 : adxl345_write_fifo_ctl(priv);
+    if (ret < 0)
+        priv->fifo_watermark = old_watermark;
+
+    return ret;
+}
+
+static int adxl345_fifo_drain(struct adxl345_data *priv, u64 irq_ts);
+
+/*
+ * adxl345_set_rate - Programme BW_RATE (ODR + LOW_POWER)
+ *
+ * La FIFO (mode stream) est vidée avant le changement pour que les
+ * échantillons déjà produits gardent la période de l'ancien débit, puis le watermark est
+ * recalculé pour le nouveau. Doit être appelée avec priv->lock.
+ */
+static int adxl345_set_rate(struct adxl345_data *priv, u8 odr_code, bool low_power)
+{
+    u8 bw_rate = odr_code & ADXL345_BW_RATE_MASK;
+    int ret;
+
+    if (adxl345_odr_mhz[odr_code] > priv->max_odr_mhz)
+        return -ERANGE;
+
+    if (low_power) {
+        if (odr_code < ADXL345_RATE_12_5HZ || odr_code > ADXL345_RATE_400HZ)
+            return -EINVAL;
+        bw_rate |= ADXL345_BW_LOW_POWER;
+    }
+
+    if (!priv->data_ready) {
+        ret = adxl345_fifo_drain(priv, 0);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = adxl345_write_reg(priv, ADXL345_BW_RATE, bw_rate);
+    if (ret < 0)
+        return ret;
+
+    priv->odr_code = odr_code;
+    priv->low_power = low_power;
+    priv->sample_period_ns = div_u64((u64)NSEC_PER_SEC * 1000, adxl345_odr_mhz[odr_code]);
+
+    return adxl345_write_fifo_ctl(priv);
+}
+
+/*
+ * adxl345_set_format - Programme la plage et FULL_RES de DATA_FORMAT
+ *
+ * Comme pour le débit, la FIFO est vidée avant le changement : chaque
+ * échantillon garde dans flags l'échelle sous laquelle il a été acquis.
+ * Doit être appelée avec priv->lock.
+ */
+static int adxl345_set_format(struct adxl345_data *priv, u8 range, bool full_res)
+{
+    int data_format;
+    int ret;
+
+    data_format = adxl345_read_reg(priv, ADXL345_DATA_FORMAT);
+    if (data_format < 0)
+        return data_format;
+
+    if (!priv->data_ready) {
+        ret = adxl345_fifo_drain(priv, 0);
+        if (ret < 0)
+            return ret;
+    }
+
+    data_format &= ~(ADXL345_RANGE_MASK | ADXL345_FULL_RES);
+    data_format |= range & ADXL345_RANGE_MASK;
+    if (full_res)
+        data_format |= ADXL345_FULL_RES;
+
+    ret = adxl345_write_reg(priv, ADXL345_DATA_FORMAT, data_format);
+    if (ret < 0)
+        return ret;
+
+    priv->range = range & ADXL345_RANGE_MASK;
+    priv->full_res = full_res;
+    priv->scale_idx = full_res ? 0 : priv->range;
+
+    return 0;
+}
+
+/*
+ * adxl345_g_to_range - Code de plage pour 2, 4, 8 ou 16 g, -EINVAL sinon
+ */
+static int adxl345_g_to_range(unsigned int g)
+{
+    switch (g) {
+    case 2: return ADXL345_RANGE_2G;
+    case 4: return ADXL345_RANGE_4G;
+    case 8: return ADXL345_RANGE_8G;
+    case 16: return ADXL345_RANGE_16G;
+    default: return -EINVAL;
+    }
+}
+
+/*
+ * adxl345_odr_to_code - Rate code dont le débit est le plus proche de mhz
+ */
+static u8 adxl345_odr_to_code(u32 mhz)
+{
+    u8 best = 0;
+    u8 code;
+
+    for (code = 1; code < ARRAY_SIZE(adxl345_odr_mhz); code++) {
+        if (abs((s64)adxl345_odr_mhz[code] - mhz) < abs((s64)adxl345_odr_mhz[best] - mhz))
+            best = code;
+    }
+
+    return best;
+}
+
+/*
+ * adxl345_subscribe - Enregistre une file d'événements vide
+ */
+static void adxl345_subscribe(struct adxl345_data *priv, struct adxl345_subscriber *sub)
+{
+    INIT_KFIFO(sub->events);
+    sub->overflow = 0;
+
+    spin_lock_irq(&priv->event_lock);
+    list_add_tail(&sub->node, &priv->subscribers);
+    spin_unlock_irq(&priv->event_lock);
+}
+
+static void adxl345_unsubscribe(struct adxl345_data *priv, struct adxl345_subscriber *sub)
+{
+    spin_lock_irq(&priv->event_lock);
+    list_del(&sub->node);
+    spin_unlock_irq(&priv->event_lock);
+}
+
+/*
+ * adxl345_push_event - Distribue un événement à tous les abonnés
+ *
+ * Chaque abonné a sa propre file : un lecteur lent ne perd que ses propres
+ * événements, comptés dans son compteur overflow.
+ */
+static void adxl345_push_event(struct adxl345_data *priv, u8 type, u8 axes, u64 timestamp_ns)
+{
+    struct adxl345_subscriber *sub;
+    struct adxl345_event event = {
+        .timestamp_ns = timestamp_ns,
+        .type = type,
+        .axes = axes,
+    };
+
+    spin_lock_irq(&priv->event_lock);
+    list_for_each_entry(sub, &priv->subscribers, node) {
+        event.overflow = sub->overflow;
+        if (!kfifo_put(&sub->events, event))
+            sub->overflow++;
+    }
+    spin_unlock_irq(&priv->event_lock);
+
+    trace_adxl345_event_queued(priv->index, type, axes, timestamp_ns);
+    wake_up_interruptible(&priv->wait_queue);
+}
+
+/*
+ * adxl345_pop_events - Retire jusqu'à n événements de la file d'un abonné
+ */
+static unsigned int adxl345_pop_events(struct adxl345_data *priv, struct adxl345_subscriber *sub,
+                                       struct adxl345_event *events, unsigned int n)
+{
+    unsigned int ret;
+
+    spin_lock_irq(&priv->event_lock);
+    ret = kfifo_out(&sub->events, events, n);
+    spin_unlock_irq(&priv->event_lock);
+
+    return ret;
+}
+
+/*
+ * adxl345_peek_events - Copie jusqu'à n événements sans les retirer
+ *
+ * Avec adxl345_skip_events(), permet de ne retirer un événement qu'une fois
+ * copié en espace utilisateur.
+ */
+static unsigned int adxl345_peek_events(struct adxl345_data *priv, struct adxl345_subscriber *sub,
+                                        struct adxl345_event *events, unsigned int n)
+{
+    unsigned int ret;
+
+    spin_lock_irq(&priv->event_lock);
+    ret = kfifo_out_peek(&sub->events, events, n);
+    spin_unlock_irq(&priv->event_lock);
+
+    return ret;
+}
+
+static void adxl345_skip_events(struct adxl345_data *priv, struct adxl345_subscriber *sub,
+                                unsigned int n)
+{
+    spin_lock_irq(&priv->event_lock);
+    while (n--)
+        kfifo_skip(&sub->events);
+    spin_unlock_irq(&priv->event_lock);
+}
+
+/*
+ * adxl345_pop_tap - Retire les événements d'un abonné jusqu'au premier tap
+ *
+ * Les événements de mouvement sont abandonnés. Retourne true si un tap a
+ * été placé dans event.
+ */
+static bool adxl345_pop_tap(struct adxl345_data *priv, struct adxl345_subscriber *sub,
+                            struct adxl345_event *event)
+{
+    while (adxl345_pop_events(priv, sub, event, 1) == 1) {
+        if (event->type == ADXL345_EVENT_SINGLE_TAP || event->type == ADXL345_EVENT_DOUBLE_TAP)
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * adxl345_pm_get/put - Référence runtime PM d'un utilisateur du flux
+ *
+ * Le capteur reste en mesure tant qu'un fichier est ouvert, que le buffer
+ * IIO est actif ou que la détection de tap est armée. Ne pas appeler avec
+ * priv->lock : les callbacks runtime PM le prennent.
+ */
+static int adxl345_pm_get(struct adxl345_data *priv)
+{
+    return pm_runtime_resume_and_get(priv->dev);
+}
+
+static void adxl345_pm_put(struct adxl345_data *priv)
+{
+    pm_runtime_mark_last_busy(priv->dev);
+    pm_runtime_put_autosuspend(priv->dev);
+}
+
+static void adxl345_data_release(struct kref *kref);
+
+// Rend une référence sur priv (descripteur fermé ou fin du remove)
+static void adxl345_put_data(void *data)
+{
+    struct adxl345_data *priv = data;
+
+    kref_put(&priv->kref, adxl345_data_release);
+}
+
+/*
+ * adxl345_lock_live - Prend priv->lock si le capteur n'a pas été retiré
+ *
+ * Un descripteur resté ouvert après le remove obtient -ENODEV au lieu
+ * d'accéder au bus.
+ */
+static int adxl345_lock_live(struct adxl345_data *priv)
+{
+    mutex_lock(&priv->lock);
+    if (priv->dead) {
+        mutex_unlock(&priv->lock);
+        return -ENODEV;
+    }
+
+    return 0;
+}
+
+/*
+ * adxl345_update_events_pm - Prend ou rend la référence des détections armées
+ *
+ * Les détections sont armées si tap_mode n'est pas 'o' ou si une interruption
+ * de mouvement est active. À appeler sans priv->lock après un changement de
+ * tap_mode ou des interruptions de mouvement.
+ */
+static int adxl345_update_events_pm(struct adxl345_data *priv)
+{
+    bool armed;
+    int ret = 0;
+
+    mutex_lock(&priv->events_pm_lock);
+
+    mutex_lock(&priv->lock);
+    armed = priv->tap_mode != 'o' || (priv->int_enable & ADXL345_INT_MOTION_MASK);
+    mutex_unlock(&priv->lock);
+
+    if (armed && !priv->events_pm_ref) {
+        ret = adxl345_pm_get(priv);
+        if (ret == 0)
+            priv->events_pm_ref = true;
+    } else if (!armed && priv->events_pm_ref) {
+        adxl345_pm_put(priv);
+        priv->events_pm_ref = false;
+    }
+
+    mutex_unlock(&priv->events_pm_lock);
+    return ret;
+}
+
+static ssize_t tap_axis_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    char axis_char;
+    
+    mutex_lock(&priv->lock);
+    axis_char = priv->tap_axis;
+    mutex_unlock(&priv->lock);
+    
+    return sprintf(buf, "%c\n", axis_char);
+}
+
+static ssize_t tap_axis_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u8 new_axis = 0;
+    u8 config;
+    int ret;
+
+    if (count < 1)
+        return -EINVAL;
+    
+    switch (buf[0]) {
+        case 'x': case 'X': 
+            new_axis = ADXL345_TAP_AXIS_X; break;
+        case 'y': case 'Y': 
+            new_axis = ADXL345_TAP_AXIS_Y; break;
+        case 'z': case 'Z': 
+            new_axis = ADXL345_TAP_AXIS_Z; break;
+        default: return -EINVAL;
+    }
+    
+    mutex_lock(&priv->lock);
+    
+    // Mettre à jour la configuration matérielle
+    config = ADXL345_SUPRESS_BIT | new_axis;
+    ret = adxl345_write_reg(priv, ADXL345_TAP_AXES, config);
+    
+    if (ret < 0) {
+        mutex_unlock(&priv->lock);
+        dev_err(dev, "Erreur configuration tap_axis\n");
+        return ret;
+    }
+    
+    priv->tap_axis = buf[0];
+    mutex_unlock(&priv->lock);
+    
+    return count;
+}
+
+static ssize_t tap_mode_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    const char *mode_str;
+    
+    mutex_lock(&priv->lock);
+    switch (priv->tap_mode) {
+        case 'o': mode_str = "off\n"; break;
+        case 's': mode_str = "single\n"; break;
+        case 'd': mode_str = "double\n"; break;
+        case 'b': mode_str = "both\n"; break;
+        default: mode_str = "unknown\n";
+    }
+    mutex_unlock(&priv->lock);
+    
+    return sprintf(buf, mode_str);
+}
+
+static ssize_t tap_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    char new_mode;
+    u8 int_enable = 0;
+    int ret;
+
+    if (strncmp(buf, "off", 3) == 0) new_mode = 'o';
+    else if (strncmp(buf, "single", 6) == 0) new_mode = 's';
+    else if (strncmp(buf, "double", 6) == 0) new_mode = 'd';
+    else if (strncmp(buf, "both", 4) == 0) new_mode = 'b';
+    else return -EINVAL;
+
+    mutex_lock(&priv->lock);
+    
+    // Configurer les interruptions matérielles selon la demande de l'utilisateur
+    switch (new_mode) {
+    case 's': 
+        int_enable = ADXL345_INT_SINGLE_TAP; 
+        break;
+    case 'd': 
+        int_enable = ADXL345_INT_DOUBLE_TAP; 
+        break;
+    case 'b': 
+        int_enable = ADXL345_INT_SINGLE_TAP | ADXL345_INT_DOUBLE_TAP; 
+        break;
+    case 'o': 
+    default: 
+        int_enable = 0;
+    }
+    // Modification du registre d'interruption (les sources FIFO restent actives)
+    ret = adxl345_write_int_enable(priv, ADXL345_INT_TAP_MASK, int_enable);
+    
+    if (ret < 0) {
+        mutex_unlock(&priv->lock);
+        dev_err(dev, "Erreur configuration tap_mode\n");
+        return ret;
+    }
+    
+    priv->tap_mode = new_mode;
+    mutex_unlock(&priv->lock);
+
+    // Tant que les taps sont armés le capteur doit mesurer
+    ret = adxl345_update_events_pm(priv);
+    if (ret < 0)
+        return ret;
+
+    return count;
+}
+
+/*
+ * tap_wait_show - Bloque jusqu'au prochain tap
+ *
+ * Chaque lecteur s'abonne le temps de l'attente : plusieurs processus
+ * peuvent attendre en même temps et reçoivent tous l'événement.
+ */
+static ssize_t tap_wait_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    struct adxl345_subscriber *sub;
+    struct adxl345_event event;
+    bool tap = false;
+    int ret;
+
+    // File d'événements trop grande pour la pile
+    sub = kzalloc(sizeof(*sub), GFP_KERNEL);
+    if (!sub)
+        return -ENOMEM;
+
+    // Le capteur doit mesurer pendant l'attente
+    ret = adxl345_pm_get(priv);
+    if (ret < 0) {
+        kfree(sub);
+        return ret;
+    }
+
+    adxl345_subscribe(priv, sub);
+
+    // Attendre un tap (interruptible par un signal), les mouvements sont
+    // ignorés. Le remove réveille l'attente avant de retirer l'attribut.
+    ret = wait_event_interruptible(priv->wait_queue,
+        (tap = adxl345_pop_tap(priv, sub, &event)) || READ_ONCE(priv->dead));
+
+    adxl345_unsubscribe(priv, sub);
+    adxl345_pm_put(priv);
+    kfree(sub);
+
+    if (ret)
+        return ret;
+    if (!tap)
+        return -ENODEV;
+
+    return sprintf(buf, "%s\n", (event.type == ADXL345_EVENT_SINGLE_TAP) ? "single" : "double");
+}
+
+static ssize_t tap_count_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    return sprintf(buf, "%d\n", atomic_read(&priv->tap_count));
+}
+
+static ssize_t fifo_watermark_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u8 watermark;
+
+    mutex_lock(&priv->lock);
+    watermark = priv->fifo_watermark;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%u\n", watermark);
+}
+
+static ssize_t fifo_watermark_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u8 watermark;
+    int ret;
+
+    ret = kstrtou8(buf, 0, &watermark);
+    if (ret)
+        return ret;
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_set_watermark(priv, watermark);
+    mutex_unlock(&priv->lock);
+
+    if (ret == -EINVAL)
+        return ret;
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration FIFO_CTL\n");
+        return ret;
+    }
+
+    return count;
+}
+
+static ssize_t fifo_dropped_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    return sprintf(buf, "%d\n", atomic_read(&priv->fifo_dropped));
+}
+
+static ssize_t data_irq_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    bool data_ready;
+
+    mutex_lock(&priv->lock);
+    data_ready = priv->data_ready;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%s\n", data_ready ? "data_ready" : "watermark");
+}
+
+/*
+ * data_irq_store - Choisit l'interruption qui alimente le flux d'échantillons
+ *
+ * "watermark"  : FIFO en stream, une IRQ par salve de fifo_watermark échantillons
+ * "data_ready" : FIFO en bypass, une IRQ par échantillon (latence minimale)
+ */
+static ssize_t data_irq_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    bool data_ready;
+    int ret;
+
+    if (strncmp(buf, "watermark", 9) == 0) data_ready = false;
+    else if (strncmp(buf, "data_ready", 10) == 0) data_ready = true;
+    else return -EINVAL;
+
+    mutex_lock(&priv->lock);
+
+    if (data_ready == priv->data_ready) {
+        mutex_unlock(&priv->lock);
+        return count;
+    }
+
+    // Couper les sources de données le temps de reconfigurer la FIFO
+    ret = adxl345_write_int_enable(priv, ADXL345_INT_DATA_MASK, 0);
+    if (ret < 0)
+        goto out_err;
+
+    priv->data_ready = data_ready;
+    ret = adxl345_write_fifo_ctl(priv);
+    if (ret < 0)
+        goto out_err;
+
+    // La ligne est retombée : un DATA_READY déjà présent produira un front
+    ret = adxl345_write_int_enable(priv, ADXL345_INT_DATA_MASK,
+        data_ready ? ADXL345_INT_DATA_READY : ADXL345_INT_FIFO_MASK);
+    if (ret < 0)
+        goto out_err;
+
+    mutex_unlock(&priv->lock);
+    return count;
+
+out_err:
+    mutex_unlock(&priv->lock);
+    dev_err(dev, "Erreur configuration data_irq\n");
+    return ret;
+}
+
+static ssize_t odr_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u32 mhz;
+
+    mutex_lock(&priv->lock);
+    mhz = adxl345_odr_mhz[priv->odr_code];
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%u.%03u\n", mhz / 1000, mhz % 1000);
+}
+
+/*
+ * odr_store - Fréquence en Hz, décimales acceptées ("12.5", "0.1", "800")
+ */
+static ssize_t odr_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    unsigned int hz, frac = 0, scale = 100;
+    const char *p;
+    int ret;
+
+    // Partie entière puis au plus trois décimales
+    if (sscanf(buf, "%u", &hz) != 1 || hz > 3200)
+        return -EINVAL;
+
+    p = strchr(buf, '.');
+    if (p) {
+        for (p++; *p >= '0' && *p <= '9' && scale; p++, scale /= 10)
+            frac += (*p - '0') * scale;
+    }
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_set_rate(priv, adxl345_odr_to_code(hz * 1000 + frac), priv->low_power);
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration odr: %d\n", ret);
+        return ret;
+    }
+
+    return count;
+}
+
+static ssize_t odr_available_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int len = 0;
+    u8 code;
+
+    // Seuls les débits soutenables par le bus sont proposés
+    for (code = 0; code < ARRAY_SIZE(adxl345_odr_mhz); code++) {
+        u32 mhz = adxl345_odr_mhz[code];
+
+        if (mhz > priv->max_odr_mhz)
+            break;
+        len += sprintf(buf + len, "%u.%03u ", mhz / 1000, mhz % 1000);
+    }
+
+    if (len)
+        buf[len - 1] = '\n';
+
+    return len;
+}
+
+static ssize_t low_power_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    bool low_power;
+
+    mutex_lock(&priv->lock);
+    low_power = priv->low_power;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%d\n", low_power);
+}
+
+static ssize_t low_power_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    bool low_power;
+    int ret;
+
+    ret = kstrtobool(buf, &low_power);
+    if (ret)
+        return ret;
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_set_rate(priv, priv->odr_code, low_power);
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration low_power: %d\n", ret);
+        return ret;
+    }
+
+    return count;
+}
+
+static ssize_t range_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u8 range;
+
+    mutex_lock(&priv->lock);
+    range = priv->range;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%u\n", 2 << range);
+}
+
+/*
+ * range_store - Plage en g : 2, 4, 8 ou 16
+ */
+static ssize_t range_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    unsigned int g;
+    int range;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &g);
+    if (ret)
+        return ret;
+
+    range = adxl345_g_to_range(g);
+    if (range < 0)
+        return range;
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_set_format(priv, range, priv->full_res);
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration range: %d\n", ret);
+        return ret;
+    }
+
+    return count;
+}
+
+static ssize_t full_res_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    bool full_res;
+
+    mutex_lock(&priv->lock);
+    full_res = priv->full_res;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%d\n", full_res);
+}
+
+static ssize_t full_res_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    bool full_res;
+    int ret;
+
+    ret = kstrtobool(buf, &full_res);
+    if (ret)
+        return ret;
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_set_format(priv, priv->range, full_res);
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration full_res: %d\n", ret);
+        return ret;
+    }
+
+    return count;
+}
+
+/*
+ * adxl345_to_lsb - Convertit une valeur physique en LSB d'un registre 8 bits
+ * @unit: valeur d'un LSB, dans l'unité de val multipliée par div
+ * Retourne le nombre de LSB, ou -ERANGE s'il ne tient pas sur 8 bits.
+ */
+static int adxl345_to_lsb(u32 val, u32 unit, u32 div)
+{
+    u64 lsb = DIV_ROUND_CLOSEST_ULL((u64)val * div, unit);
+
+    return lsb > 0xFF ? -ERANGE : lsb;
+}
+
+/*
+ * adxl345_parse_axes - Sous-ensemble de "xyz" en bits ADXL345_TAP_AXIS_*
+ * Retourne les bits, ou -EINVAL sur un caractère inconnu.
+ */
+static int adxl345_parse_axes(const char *buf, size_t count)
+{
+    u8 axes = 0;
+    size_t i;
+
+    for (i = 0; i < count && buf[i] && buf[i] != '\n'; i++) {
+        switch (buf[i]) {
+        case 'x': case 'X': axes |= ADXL345_TAP_AXIS_X; break;
+        case 'y': case 'Y': axes |= ADXL345_TAP_AXIS_Y; break;
+        case 'z': case 'Z': axes |= ADXL345_TAP_AXIS_Z; break;
+        default: return -EINVAL;
+        }
+    }
+
+    return axes;
+}
+
+/*
+ * adxl345_motion_show - Affiche un registre de mouvement converti en unités
+ * @unit: valeur d'un LSB, dans l'unité affichée multipliée par div
+ */
+static ssize_t adxl345_motion_show(struct device *dev, char *buf, u8 reg, u32 unit, u32 div)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int val;
+
+    mutex_lock(&priv->lock);
+    val = adxl345_read_reg(priv, reg);
+    mutex_unlock(&priv->lock);
+
+    if (val < 0)
+        return val;
+
+    return sprintf(buf, "%u\n", (u32)val * unit / div);
+}
+
+/*
+ * adxl345_motion_store - Programme un seuil ou une durée de mouvement
+ * @int_bit: interruption armée si la valeur est non nulle (0 pour une durée)
+ *
+ * Un seuil à 0 désarme l'interruption correspondante : la datasheet
+ * déconseille de l'activer avec un seuil nul.
+ */
+static ssize_t adxl345_motion_store(struct device *dev, const char *buf, size_t count,
+                                    u8 reg, u32 unit, u32 div, u8 int_bit)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    unsigned int val;
+    int lsb;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &val);
+    if (ret)
+        return ret;
+
+    lsb = adxl345_to_lsb(val, unit, div);
+    if (lsb < 0)
+        return lsb;
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_write_reg(priv, reg, lsb);
+    if (ret == 0 && int_bit)
+        ret = adxl345_write_int_enable(priv, int_bit, lsb ? int_bit : 0);
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration registre 0x%02x\n", reg);
+        return ret;
+    }
+
+    if (int_bit) {
+        ret = adxl345_update_events_pm(priv);
+        if (ret < 0)
+            return ret;
+    }
+
+    return count;
+}
+
+// Seuils en mg (62.5 mg/LSB)
+static ssize_t activity_threshold_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return adxl345_motion_show(dev, buf, ADXL345_THRESH_ACT, ADXL345_THRESH_UG_PER_LSB, 1000);
+}
+
+static ssize_t activity_threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    return adxl345_motion_store(dev, buf, count, ADXL345_THRESH_ACT, ADXL345_THRESH_UG_PER_LSB, 1000,
+                                ADXL345_INT_ACTIVITY);
+}
+
+static ssize_t inactivity_threshold_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return adxl345_motion_show(dev, buf, ADXL345_THRESH_INACT, ADXL345_THRESH_UG_PER_LSB, 1000);
+}
+
+static ssize_t inactivity_threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    return adxl345_motion_store(dev, buf, count, ADXL345_THRESH_INACT, ADXL345_THRESH_UG_PER_LSB, 1000,
+                                ADXL345_INT_INACTIVITY);
+}
+
+// Durée d'inactivité en secondes (1 s/LSB)
+static ssize_t inactivity_time_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return adxl345_motion_show(dev, buf, ADXL345_TIME_INACT, 1, 1);
+}
+
+static ssize_t inactivity_time_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    return adxl345_motion_store(dev, buf, count, ADXL345_TIME_INACT, 1, 1, 0);
+}
+
+// Seuil de chute libre en mg (62.5 mg/LSB, 300 à 600 mg recommandés)
+static ssize_t freefall_threshold_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return adxl345_motion_show(dev, buf, ADXL345_THRESH_FF, ADXL345_THRESH_UG_PER_LSB, 1000);
+}
+
+static ssize_t freefall_threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    return adxl345_motion_store(dev, buf, count, ADXL345_THRESH_FF, ADXL345_THRESH_UG_PER_LSB, 1000,
+                                ADXL345_INT_FREE_FALL);
+}
+
+// Durée de chute libre en ms (5 ms/LSB, 100 à 350 ms recommandés)
+static ssize_t freefall_time_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return adxl345_motion_show(dev, buf, ADXL345_TIME_FF, ADXL345_TIME_FF_MS_PER_LSB, 1);
+}
+
+static ssize_t freefall_time_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    return adxl345_motion_store(dev, buf, count, ADXL345_TIME_FF, ADXL345_TIME_FF_MS_PER_LSB, 1, 0);
+}
+
+/*
+ * act_inact_axes - Axes participant à l'activité et à l'inactivité ("xyz", "z", ...)
+ */
+static ssize_t act_inact_axes_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int ctl;
+    int len = 0;
+
+    mutex_lock(&priv->lock);
+    ctl = adxl345_read_reg(priv, ADXL345_ACT_INACT_CTL);
+    mutex_unlock(&priv->lock);
+
+    if (ctl < 0)
+        return ctl;
+
+    ctl >>= ADXL345_ACT_SHIFT;
+    if (ctl & ADXL345_TAP_AXIS_X) buf[len++] = 'x';
+    if (ctl & ADXL345_TAP_AXIS_Y) buf[len++] = 'y';
+    if (ctl & ADXL345_TAP_AXIS_Z) buf[len++] = 'z';
+    buf[len++] = '\n';
+
+    return len;
+}
+
+static ssize_t act_inact_axes_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int axes;
+    int ctl;
+    int ret;
+
+    axes = adxl345_parse_axes(buf, count);
+    if (axes < 0)
+        return axes;
+
+    mutex_lock(&priv->lock);
+    ret = ctl = adxl345_read_reg(priv, ADXL345_ACT_INACT_CTL);
+    if (ctl >= 0) {
+        // Mêmes axes pour l'activité et l'inactivité, couplage conservé
+        ctl &= ADXL345_ACT_INACT_AC | (ADXL345_ACT_INACT_AC << ADXL345_ACT_SHIFT);
+        ctl |= axes | (axes << ADXL345_ACT_SHIFT);
+        ret = adxl345_write_reg(priv, ADXL345_ACT_INACT_CTL, ctl);
+    }
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration act_inact_axes\n");
+        return ret;
+    }
+
+    return count;
+}
+
+/*
+ * act_inact_coupling - "dc" : seuils absolus, "ac" : relatifs à l'accélération
+ * au moment de la détection (compense la gravité)
+ */
+static ssize_t act_inact_coupling_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int ctl;
+
+    mutex_lock(&priv->lock);
+    ctl = adxl345_read_reg(priv, ADXL345_ACT_INACT_CTL);
+    mutex_unlock(&priv->lock);
+
+    if (ctl < 0)
+        return ctl;
+
+    return sprintf(buf, "%s\n", (ctl & ADXL345_ACT_INACT_AC) ? "ac" : "dc");
+}
+
+static ssize_t act_inact_coupling_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    const u8 ac_bits = ADXL345_ACT_INACT_AC | (ADXL345_ACT_INACT_AC << ADXL345_ACT_SHIFT);
+    bool ac;
+    int ctl;
+    int ret;
+
+    if (strncmp(buf, "ac", 2) == 0) ac = true;
+    else if (strncmp(buf, "dc", 2) == 0) ac = false;
+    else return -EINVAL;
+
+    mutex_lock(&priv->lock);
+    ret = ctl = adxl345_read_reg(priv, ADXL345_ACT_INACT_CTL);
+    if (ctl >= 0)
+        ret = adxl345_write_reg(priv, ADXL345_ACT_INACT_CTL, ac ? (ctl | ac_bits) : (ctl & ~ac_bits));
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration act_inact_coupling\n");
+        return ret;
+    }
+
+    return count;
+}
+
+/*
+ * adxl345_set_offsets - Programme OFSX/OFSY/OFSZ en une écriture groupée
+ * Doit être appelée avec priv->lock.
+ */
+static int adxl345_set_offsets(struct adxl345_data *priv, const s8 *ofs)
+{
+    u8 regs[ADXL345_OFS_LEN];
+    int i;
+
+    for (i = 0; i < ADXL345_OFS_LEN; i++)
+        regs[i] = (u8)ofs[i];
+
+    return adxl345_write_regs(priv, ADXL345_OFSX, ADXL345_OFS_LEN, regs);
+}
+
+// Offsets courants, depuis le cache. Doit être appelée avec priv->lock.
+static int adxl345_get_offsets(struct adxl345_data *priv, s8 *ofs)
+{
+    int ret;
+    int i;
+
+    for (i = 0; i < ADXL345_OFS_LEN; i++) {
+        ret = adxl345_read_reg(priv, ADXL345_OFSX + i);
+        if (ret < 0)
+            return ret;
+        ofs[i] = (s8)ret;
+    }
+
+    return 0;
+}
+
+/*
+ * adxl345_calibrate - Calcule et programme les offsets matériels
+ * @samples: nombre d'échantillons moyennés (1..ADXL345_CALIB_MAX_SAMPLES),
+ *           0 pour ADXL345_CALIB_DEFAULT
+ * @result: offsets programmés, peut être NULL
+ *
+ * Le capteur doit être immobile, à plat, Z vers le haut : X et Y sont
+ * ramenés à 0 g et Z à +1 g. Les offsets sont remis à zéro, la FIFO vidée,
+ * puis les échantillons sont collectés au passage dans push_samples. En cas
+ * d'échec les offsets précédents sont rétablis.
+ * Ne pas appeler avec priv->lock.
+ */
+static int adxl345_calibrate(struct adxl345_data *priv, u32 samples, s8 *result)
+{
+    static const s8 zero[ADXL345_OFS_LEN] = { 0 };
+    const s32 target[ADXL345_OFS_LEN] = { 0, 0, ADXL345_CALIB_1G };
+    s8 old[ADXL345_OFS_LEN];
+    s8 ofs[ADXL345_OFS_LEN];
+    u64 timeout_ns;
+    s32 mean;
+    long left;
+    int ret;
+    int i;
+
+    if (samples > ADXL345_CALIB_MAX_SAMPLES)
+        return -EINVAL;
+    if (samples == 0)
+        samples = ADXL345_CALIB_DEFAULT;
+
+    // Le capteur doit mesurer pendant toute la collecte
+    ret = adxl345_pm_get(priv);
+    if (ret < 0)
+        return ret;
+
+    ret = adxl345_lock_live(priv);
+    if (ret) {
+        adxl345_pm_put(priv);
+        return ret;
+    }
+    if (priv->calib_target) {
+        mutex_unlock(&priv->lock);
+        adxl345_pm_put(priv);
+        return -EBUSY;
+    }
+
+    ret = adxl345_get_offsets(priv, old);
+    if (ret == 0)
+        ret = adxl345_set_offsets(priv, zero);
+    if (ret < 0) {
+        mutex_unlock(&priv->lock);
+        adxl345_pm_put(priv);
+        return ret;
+    }
+
+    // Les échantillons de la FIFO ont été acquis avec les anciens offsets :
+    // publiés tels quels, la conversion en cours est écartée
+    if (!priv->data_ready)
+        adxl345_fifo_drain(priv, 0);
+
+    reinit_completion(&priv->calib_done);
+    memset(priv->calib_sum, 0, sizeof(priv->calib_sum));
+    priv->calib_count = 0;
+    priv->calib_skip = 1;
+    priv->calib_target = samples;
+    // Collecte, plus une FIFO complète de latence et une seconde de marge
+    timeout_ns = (u64)(samples + ADXL345_FIFO_DEPTH) * priv->sample_period_ns + NSEC_PER_SEC;
+    mutex_unlock(&priv->lock);
+
+    left = wait_for_completion_interruptible_timeout(&priv->calib_done, nsecs_to_jiffies(timeout_ns));
+
+    mutex_lock(&priv->lock);
+    if (priv->dead) {
+        // Réveillé par le remove : le capteur est déjà en veille
+        ret = -ENODEV;
+    } else if (priv->calib_count < priv->calib_target) {
+        ret = left < 0 ? left : -ETIMEDOUT;
+        adxl345_set_offsets(priv, old);
+    } else {
+        for (i = 0; i < ADXL345_OFS_LEN; i++) {
+            mean = DIV_ROUND_CLOSEST(priv->calib_sum[i], (s32)priv->calib_count);
+            ofs[i] = clamp_t(s32, DIV_ROUND_CLOSEST(target[i] - mean, ADXL345_OFS_SCALE), S8_MIN, S8_MAX);
+        }
+        ret = adxl345_set_offsets(priv, ofs);
+        if (ret == 0 && result)
+            memcpy(result, ofs, sizeof(ofs));
+    }
+    priv->calib_target = 0;
+    mutex_unlock(&priv->lock);
+
+    adxl345_pm_put(priv);
+
+    if (ret == 0)
+        dev_info(priv->dev, "Calibration: offsets %d %d %d (%u échantillons)\n",
+                 ofs[0], ofs[1], ofs[2], samples);
+    return ret;
+}
+
+/*
+ * offsets - Offsets matériels X Y Z, en LSB de 15.6 mg (-128..127)
+ * Permet de sauvegarder le résultat d'une calibration et de le réappliquer.
+ */
+static ssize_t offsets_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    s8 ofs[ADXL345_OFS_LEN];
+    int ret;
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_get_offsets(priv, ofs);
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0)
+        return ret;
+
+    return sprintf(buf, "%d %d %d\n", ofs[0], ofs[1], ofs[2]);
+}
+
+static ssize_t offsets_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    s8 ofs[ADXL345_OFS_LEN];
+    int val[ADXL345_OFS_LEN];
+    int ret;
+    int i;
+
+    if (sscanf(buf, "%d %d %d", &val[0], &val[1], &val[2]) != ADXL345_OFS_LEN)
+        return -EINVAL;
+
+    for (i = 0; i < ADXL345_OFS_LEN; i++) {
+        if (val[i] < S8_MIN || val[i] > S8_MAX)
+            return -ERANGE;
+        ofs[i] = val[i];
+    }
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_set_offsets(priv, ofs);
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration offsets\n");
+        return ret;
+    }
+
+    return count;
+}
+
+/*
+ * calibrate - Écrire le nombre d'échantillons à moyenner (0 : valeur par
+ * défaut), capteur immobile, Z vers le haut. Bloque jusqu'à la fin.
+ */
+static ssize_t calibrate_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    unsigned int samples;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &samples);
+    if (ret)
+        return ret;
+
+    ret = adxl345_calibrate(priv, samples, NULL);
+    return ret < 0 ? ret : count;
+}
+
+static const char * const adxl345_mode_names[] = {
+    [ADXL345_MODE_TEXT] = "text",
+    [ADXL345_MODE_BINARY] = "binary",
+    [ADXL345_MODE_STREAM] = "stream",
+};
+
+/*
+ * default_mode - Mode de lecture des descripteurs ouverts ensuite :
+ * text, binary ou stream. stream permet un simple cat /dev/adxl345 continu.
+ */
+static ssize_t default_mode_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%s\n", adxl345_mode_names[READ_ONCE(priv->default_mode)]);
+}
+
+static ssize_t default_mode_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int mode;
+
+    mode = sysfs_match_string(adxl345_mode_names, buf);
+    if (mode < 0)
+        return mode;
+
+    WRITE_ONCE(priv->default_mode, mode);
+    return count;
+}
+
+/*
+ * adxl345_capture_window_store - Modifie capture_pre ou capture_post
+ * La somme est bornée par ADXL345_CAPTURE_MAX. Une capture en cours de
+ * collecte est abandonnée, la dernière capture figée reste lisible.
+ */
+static ssize_t adxl345_capture_window_store(struct device *dev, const char *buf, size_t count, bool pre)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    unsigned int val;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &val);
+    if (ret)
+        return ret;
+
+    mutex_lock(&priv->lock);
+    if (val + (pre ? priv->capture_post : priv->capture_pre) > ADXL345_CAPTURE_MAX) {
+        mutex_unlock(&priv->lock);
+        return -EINVAL;
+    }
+    if (pre)
+        priv->capture_pre = val;
+    else
+        priv->capture_post = val;
+    priv->capture_pending = false;
+    mutex_unlock(&priv->lock);
+
+    return count;
+}
+
+static ssize_t capture_pre_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%u\n", READ_ONCE(priv->capture_pre));
+}
+
+static ssize_t capture_pre_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    return adxl345_capture_window_store(dev, buf, count, true);
+}
+
+static ssize_t capture_post_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%u\n", READ_ONCE(priv->capture_post));
+}
+
+static ssize_t capture_post_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    return adxl345_capture_window_store(dev, buf, count, false);
+}
+
+/*
+ * capture - Dernière capture figée : struct adxl345_capture_header puis
+ * pre + post struct adxl345_record. Vide tant qu'aucune capture n'a eu
+ * lieu. poll() (sysfs_notify) signale chaque nouvelle capture ; sequence
+ * permet de vérifier qu'une lecture en plusieurs morceaux est cohérente.
+ */
+static ssize_t capture_read(struct file *file, struct kobject *kobj, struct bin_attribute *attr,
+                            char *buf, loff_t off, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(kobj_to_dev(kobj));
+    size_t size;
+
+    mutex_lock(&priv->lock);
+    size = priv->capture->sequence ? sizeof(*priv->capture) +
+           (priv->capture->pre + priv->capture->post) * sizeof(struct adxl345_record) : 0;
+
+    if (off >= size) {
+        mutex_unlock(&priv->lock);
+        return 0;
+    }
+    count = min_t(size_t, count, size - off);
+    memcpy(buf, (u8 *)priv->capture + off, count);
+    mutex_unlock(&priv->lock);
+
+    return count;
+}
+
+static ssize_t suspend_count_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u32 count;
+
+    mutex_lock(&priv->lock);
+    count = priv->suspend_count;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%u\n", count);
+}
+
+static ssize_t resume_count_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u32 count;
+
+    mutex_lock(&priv->lock);
+    count = priv->resume_count;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%u\n", count);
+}
+
+/*
+ * suspended_ms_show - Temps total passé en standby, période en cours comprise
+ */
+static ssize_t suspended_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    u64 suspended_ns;
+
+    mutex_lock(&priv->lock);
+    suspended_ns = priv->suspended_ns;
+    if (priv->suspend_start)
+        suspended_ns += ktime_get_ns() - priv->suspend_start;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%llu\n", div_u64(suspended_ns, NSEC_PER_MSEC));
+}
+
+/*
+ * adxl345_ring_push - Publie une salve dans l'anneau partagé par mmap
+ *
+ * Producteur unique (thread d'IRQ, priv->lock tenu). Les données sont
+ * écrites avant que head soit publié avec une barrière release ; tail est
+ * relu avec une barrière acquire pour ne jamais écraser une entrée non
+ * consommée par l'application.
+ */
+static void adxl345_ring_push(struct adxl345_data *priv, const struct adxl345_record *batch, unsigned int n)
+{
+    struct adxl345_ring_header *hdr = priv->ring_hdr;
+    u32 head, tail;
+    unsigned int i;
+
+    if (!priv->ring_owner)
+        return;
+
+    head = hdr->head;
+    tail = smp_load_acquire(&hdr->tail);
+
+    for (i = 0; i < n; i++) {
+        if (head - tail >= ADXL345_MMAP_RING_SIZE) {
+            WRITE_ONCE(hdr->dropped, hdr->dropped + (n - i));
+            break;
+        }
+        priv->ring_records[head & (ADXL345_MMAP_RING_SIZE - 1)] = batch[i];
+        head++;
+    }
+
+    smp_store_release(&hdr->head, head);
+}
+
+/*
+ * adxl345_parse_sample - Décode DATAX0..DATAZ1 (little endian, signé)
+ */
+static void adxl345_parse_sample(const u8 *data_regs, struct adxl345_record *rec)
+{
+    rec->x = (s16)((data_regs[1] << 8) | data_regs[0]);
+    rec->y = (s16)((data_regs[3] << 8) | data_regs[2]);
+    rec->z = (s16)((data_regs[5] << 8) | data_regs[4]);
+    rec->flags = 0;
+    rec->sensor = 0;
+}
+
+/*
+ * adxl345_iio_push - Copie une salve dans le buffer IIO s'il est actif
+ *
+ * Les horodatages sont convertis de CLOCK_MONOTONIC vers l'horloge
+ * choisie pour le device IIO (current_timestamp_clock).
+ */
+static void adxl345_iio_push(struct adxl345_data *priv, const struct adxl345_record *batch,
+                             unsigned int entries)
+{
+    struct iio_dev *indio_dev = priv->indio_dev;
+    struct {
+        s16 axes[3];
+        s64 timestamp __aligned(8);
+    } scan;
+    s64 offset;
+    unsigned int i;
+
+    if (!indio_dev || !iio_buffer_enabled(indio_dev))
+        return;
+
+    memset(&scan, 0, sizeof(scan));
+    offset = iio_get_time_ns(indio_dev) - (s64)ktime_get_ns();
+
+    for (i = 0; i < entries; i++) {
+        scan.axes[0] = batch[i].x;
+        scan.axes[1] = batch[i].y;
+        scan.axes[2] = batch[i].z;
+        iio_push_to_buffers_with_timestamp(indio_dev, &scan, batch[i].timestamp_ns + offset);
+    }
+}
+
+/*
+ * adxl345_filter_step - Passe un échantillon dans le filtre d'un descripteur
+ *
+ * Retourne true si un échantillon filtré est produit dans out. Le bloc en
+ * cours repart de zéro si l'échelle change (range/full_res).
+ */
+static bool adxl345_filter_step(struct adxl345_file *file_data, const struct adxl345_record *in,
+                                struct adxl345_record *out)
+{
+    const struct adxl345_filter *filter = &file_data->filter;
+    s32 *acc = file_data->filter_acc;
+    s32 raw[3] = { in->x, in->y, in->z };
+    bool emit;
+    int i;
+
+    if (!file_data->filter_primed || in->flags != file_data->filter_flags) {
+        // Moyenne : somme vide ; passe-bas : sortie initialisée sur l'entrée
+        for (i = 0; i < 3; i++)
+            acc[i] = (filter->type == ADXL345_FILTER_LOWPASS) ? raw[i] * 256 : 0;
+        file_data->filter_count = 0;
+        file_data->filter_flags = in->flags;
+        file_data->filter_primed = true;
+    }
+
+    switch (filter->type) {
+    case ADXL345_FILTER_AVERAGE:
+        if (file_data->filter_count == 0)
+            file_data->filter_first_ts = in->timestamp_ns;
+        for (i = 0; i < 3; i++)
+            acc[i] += raw[i];
+
+        if (++file_data->filter_count < filter->factor)
+            return false;
+
+        // Horodatage au milieu du bloc moyenné
+        *out = *in;
+        out->timestamp_ns = file_data->filter_first_ts +
+            (in->timestamp_ns - file_data->filter_first_ts) / 2;
+        out->x = DIV_ROUND_CLOSEST(acc[0], (s32)filter->factor);
+        out->y = DIV_ROUND_CLOSEST(acc[1], (s32)filter->factor);
+        out->z = DIV_ROUND_CLOSEST(acc[2], (s32)filter->factor);
+        acc[0] = acc[1] = acc[2] = 0;
+        file_data->filter_count = 0;
+        return true;
+
+    case ADXL345_FILTER_DECIMATE:
+        // Premier échantillon de chaque bloc de factor
+        emit = file_data->filter_count == 0;
+        if (++file_data->filter_count >= filter->factor)
+            file_data->filter_count = 0;
+        if (emit)
+            *out = *in;
+        return emit;
+
+    case ADXL345_FILTER_LOWPASS:
+        // Passe-bas du premier ordre en Q8 : y += (x - y) >> shift
+        for (i = 0; i < 3; i++)
+            acc[i] += (raw[i] * 256 - acc[i]) >> filter->shift;
+
+        if (++file_data->filter_count < filter->factor)
+            return false;
+
+        *out = *in;
+        out->x = (acc[0] + 128) >> 8;
+        out->y = (acc[1] + 128) >> 8;
+        out->z = (acc[2] + 128) >> 8;
+        file_data->filter_count = 0;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/*
+ * adxl345_readers_push - Copie une salve dans la file de chaque descripteur
+ *
+ * Chaque lecteur binaire ou stream a sa propre file : deux lecteurs voient
+ * tous les deux chaque échantillon. Un lecteur filtré ne reçoit (et n'est
+ * réveillé) que pour les échantillons produits par son filtre. Le mode
+ * texte lit last_sample et le propriétaire de l'anneau mmap lit l'anneau :
+ * ils ne sont pas alimentés. Appelée depuis le thread d'IRQ avec priv->lock.
+ * Retourne le plus grand nombre d'échantillons en attente chez un lecteur.
+ */
+static unsigned int adxl345_readers_push(struct adxl345_data *priv, const struct adxl345_record *batch,
+                                         unsigned int entries)
+{
+    struct adxl345_record out[ADXL345_FIFO_DEPTH];
+    const struct adxl345_record *src;
+    struct adxl345_file *file_data;
+    unsigned int backlog = 0;
+    unsigned int produced;
+    unsigned int pushed;
+    unsigned int i;
+
+    list_for_each_entry(file_data, &priv->readers, reader_node) {
+        if (file_data->mode == ADXL345_MODE_TEXT || priv->ring_owner == file_data)
+            continue;
+
+        if (file_data->filter.type == ADXL345_FILTER_NONE) {
+            src = batch;
+            produced = entries;
+        } else {
+            src = out;
+            produced = 0;
+            for (i = 0; i < entries && produced < ARRAY_SIZE(out); i++) {
+                if (adxl345_filter_step(file_data, &batch[i], &out[produced]))
+                    produced++;
+            }
+            if (!produced)
+                continue;
+        }
+
+        // Si ce lecteur est en retard, ses nouveaux échantillons sont perdus
+        pushed = kfifo_in(&file_data->samples, src, produced);
+        if (pushed < produced)
+            atomic_add(produced - pushed, &priv->fifo_dropped);
+        backlog = max(backlog, kfifo_len(&file_data->samples));
+
+        wake_up_interruptible(&file_data->wait);
+    }
+
+    return backlog;
+}
+
+/*
+ * adxl345_group_push - Copie une salve dans la file de capture groupée
+ */
+static void adxl345_group_push(struct adxl345_data *priv, const struct adxl345_record *batch,
+                               unsigned int entries)
+{
+    struct adxl345_group_member *member = priv->group_member;
+    unsigned int pushed;
+
+    if (!member)
+        return;
+
+    pushed = kfifo_in(&member->samples, batch, entries);
+    if (pushed < entries)
+        member->dropped += entries - pushed;
+    WRITE_ONCE(member->last_ts, batch[entries - 1].timestamp_ns);
+
+    wake_up_interruptible(&adxl345_group_wait);
+}
+
+/*
+ * adxl345_calib_push - Accumule une salve pour la calibration en cours
+ * Les échantillons sont ramenés en LSB de 3.9 mg selon leur échelle.
+ */
+static void adxl345_calib_push(struct adxl345_data *priv, const struct adxl345_record *batch,
+                               unsigned int entries)
+{
+    unsigned int i;
+
+    for (i = 0; i < entries && priv->calib_count < priv->calib_target; i++) {
+        if (priv->calib_skip) {
+            priv->calib_skip--;
+            continue;
+        }
+        priv->calib_sum[0] += batch[i].x * (1 << batch[i].flags);
+        priv->calib_sum[1] += batch[i].y * (1 << batch[i].flags);
+        priv->calib_sum[2] += batch[i].z * (1 << batch[i].flags);
+        if (++priv->calib_count == priv->calib_target)
+            complete(&priv->calib_done);
+    }
+}
+
+/*
+ * adxl345_capture_freeze - Fige la fenêtre autour de l'événement en attente
+ * @end: index suivant le dernier échantillon de la fenêtre
+ *
+ * Les capture_post derniers échantillons sont postérieurs à l'événement,
+ * ceux qui les précèdent dans l'historique forment le pré-déclenchement
+ * (moins que capture_pre si l'historique n'est pas encore rempli).
+ */
+static void adxl345_capture_freeze(struct adxl345_data *priv, u32 end)
+{
+    struct adxl345_capture_header *hdr = priv->capture;
+    struct adxl345_record *records = (struct adxl345_record *)(hdr + 1);
+    u32 avail = min_t(u32, end, ADXL345_CAPTURE_MAX);
+    u32 total = min_t(u32, priv->capture_pre + priv->capture_post, avail);
+    u32 start = end - total;
+    u32 i;
+
+    for (i = 0; i < total; i++)
+        records[i] = priv->capture_hist[(start + i) & (ADXL345_CAPTURE_MAX - 1)];
+
+    *hdr = priv->capture_trigger;
+    hdr->post = min_t(u32, priv->capture_post, total);
+    hdr->pre = total - hdr->post;
+    hdr->sequence = ++priv->capture_seq;
+    hdr->record_size = sizeof(struct adxl345_record);
+
+    priv->capture_pending = false;
+    sysfs_notify(&priv->dev->kobj, NULL, "capture");
+}
+
+/*
+ * adxl345_capture_push - Alimente l'historique de capture
+ *
+ * Un événement est daté avant que la FIFO ne soit vidée : les échantillons
+ * postérieurs sont reconnus à leur horodatage, pas à leur ordre d'arrivée.
+ */
+static void adxl345_capture_push(struct adxl345_data *priv, const struct adxl345_record *batch,
+                                 unsigned int entries)
+{
+    unsigned int i;
+
+    if (!priv->capture_pre && !priv->capture_post)
+        return;
+
+    for (i = 0; i < entries; i++) {
+        priv->capture_hist[priv->capture_head++ & (ADXL345_CAPTURE_MAX - 1)] = batch[i];
+
+        if (!priv->capture_pending || batch[i].timestamp_ns <= priv->capture_trigger.timestamp_ns)
+            continue;
+
+        // Sans post-déclenchement, le premier échantillon postérieur sert
+        // seulement à savoir que l'historique est complet : il est exclu
+        if (!priv->capture_post)
+            adxl345_capture_freeze(priv, priv->capture_head - 1);
+        else if (++priv->capture_seen == priv->capture_post)
+            adxl345_capture_freeze(priv, priv->capture_head);
+    }
+}
+
+/*
+ * adxl345_capture_trigger - Démarre une capture sur tap ou activité
+ * Ignoré si une capture est déjà en cours de collecte.
+ */
+static void adxl345_capture_trigger(struct adxl345_data *priv, u8 type, u8 axes, u64 timestamp_ns)
+{
+    if ((!priv->capture_pre && !priv->capture_post) || priv->capture_pending)
+        return;
+
+    memset(&priv->capture_trigger, 0, sizeof(priv->capture_trigger));
+    priv->capture_trigger.timestamp_ns = timestamp_ns;
+    priv->capture_trigger.type = type;
+    priv->capture_trigger.axes = axes;
+    priv->capture_seen = 0;
+    priv->capture_pending = true;
+}
+
+/*
+ * adxl345_push_samples - Date une salve et la publie vers les lecteurs
+ * @priv: données du driver
+ * @batch: échantillons dans l'ordre d'acquisition
+ * @entries: nombre d'échantillons
+ * @ref_ts: instant connu pour l'échantillon ref_idx
+ * @ref_idx: index de l'échantillon de référence dans la salve
+ *
+ * Les autres échantillons sont interpolés à partir de la période de l'ODR,
+ * avant et après la référence. Les lecteurs sont réveillés une seule fois
+ * par salve.
+ */
+static void adxl345_push_samples(struct adxl345_data *priv, struct adxl345_record *batch,
+                                 unsigned int entries, u64 ref_ts, unsigned int ref_idx)
+{
+    unsigned int backlog;
+    unsigned int i;
+
+    if (!entries)
+        return;
+
+    for (i = 0; i < entries; i++) {
+        batch[i].timestamp_ns = ref_ts + ((s64)i - ref_idx) * (s64)priv->sample_period_ns;
+        batch[i].flags = priv->scale_idx;
+        batch[i].sensor = priv->index;
+    }
+
+    backlog = adxl345_readers_push(priv, batch, entries);
+    adxl345_ring_push(priv, batch, entries);
+    adxl345_iio_push(priv, batch, entries);
+    adxl345_group_push(priv, batch, entries);
+    adxl345_calib_push(priv, batch, entries);
+    adxl345_capture_push(priv, batch, entries);
+    priv->last_sample = batch[entries - 1];
+
+    trace_adxl345_readers_woken(priv->index, entries, backlog);
+    wake_up_interruptible(&priv->read_queue);
+}
+
+/*
+ * adxl345_fifo_drain - Vide la FIFO matérielle dans le ring buffer noyau
+ * @priv: données du driver
+ * @irq_ts: instant de l'interruption watermark, 0 hors interruption
+ *
+ * L'interruption watermark date l'échantillon qui a atteint le seuil ;
+ * ceux arrivés depuis sont datés en avant à partir de lui. Sans
+ * interruption (ou après un overrun) le dernier échantillon est daté à la
+ * fin de la lecture.
+ *
+ * Lit FIFO_STATUS une seule fois puis chaque entrée (6 octets) avec une
+ * lecture bloc, et publie toute la salve d'un coup.
+ * Appelée depuis le thread d'IRQ avec priv->lock.
+ * Retourne le nombre d'échantillons lus ou un code d'erreur négatif.
+ */
+static int adxl345_fifo_drain(struct adxl345_data *priv, u64 irq_ts)
+{
+    struct adxl345_record batch[ADXL345_FIFO_DEPTH];
+    u8 data_regs[ADXL345_DATA_LEN];
+    unsigned int entries;
+    unsigned int i;
+    int ret;
+
+    if (priv->data_ready) {
+        // FIFO en bypass : un seul échantillon, inutile de lire FIFO_STATUS
+        entries = 1;
+    } else {
+        ret = adxl345_read_reg(priv, ADXL345_FIFO_STATUS);
+        if (ret < 0)
+            return ret;
+
+        entries = min_t(unsigned int, ret & ADXL345_FIFO_ENTRIES, ADXL345_FIFO_DEPTH);
+    }
+
+    for (i = 0; i < entries; i++) {
+        // Chaque lecture bloc de DATAX0..DATAZ1 dépile une entrée de la FIFO
+        ret = adxl345_read_regs(priv, ADXL345_DATAX0, sizeof(data_regs), data_regs);
+        if (ret < 0)
+            return ret;
+
+        adxl345_parse_sample(data_regs, &batch[i]);
+    }
+
+    if (!entries)
+        return 0;
+
+    // FIFO pleine : des échantillons ont pu être perdus, le seuil ne
+    // désigne plus un échantillon connu
+    if (irq_ts && priv->fifo_trigger <= entries && entries < ADXL345_FIFO_DEPTH)
+        adxl345_push_samples(priv, batch, entries, irq_ts, priv->fifo_trigger - 1);
+    else
+        adxl345_push_samples(priv, batch, entries, ktime_get_ns(), entries - 1);
+
+    return entries;
+}
+
+/*
+ * adxl345_handle_tap - Traite une détection single/double tap
+ * @priv: données du driver
+ * @int_source: valeur de INT_SOURCE déjà lue
+ * @tap_status: valeur de ACT_TAP_STATUS lue dans la même transaction
+ * @timestamp: instant de l'interruption
+ *
+ * Retourne true si un événement tap a été signalé.
+ */
+static bool adxl345_handle_tap(struct adxl345_data *priv, u8 int_source, u8 tap_status, u64 timestamp)
+{
+    int event_type = 0;
+
+    // Identifier le type d'événement
+    if (int_source & ADXL345_INT_SINGLE_TAP) {
+        event_type = ADXL345_EVENT_SINGLE_TAP;
+    }
+    if (int_source & ADXL345_INT_DOUBLE_TAP) {
+        event_type = ADXL345_EVENT_DOUBLE_TAP;
+    }
+
+    if (!event_type)
+        return false;
+
+    // Pas de printk ici : la console est synchrone, l'événement est tracé
+    atomic_inc(&priv->tap_count);
+    adxl345_push_event(priv, event_type, tap_status & ADXL345_TAP_AXES_MASK, timestamp);
+    adxl345_capture_trigger(priv, event_type, tap_status & ADXL345_TAP_AXES_MASK, timestamp);
+
+    return true;
+}
+
+/*
+ * adxl345_handle_motion - Traite activité, inactivité et chute libre
+ * @priv: données du driver
+ * @int_source: valeur de INT_SOURCE déjà lue
+ * @act_status: valeur de ACT_TAP_STATUS lue dans la même transaction
+ * @timestamp: instant de l'interruption
+ *
+ * Retourne true si au moins un événement a été signalé.
+ */
+static bool adxl345_handle_motion(struct adxl345_data *priv, u8 int_source, u8 act_status, u64 timestamp)
+{
+    u8 axes = (act_status >> ADXL345_ACT_AXES_SHIFT) & ADXL345_TAP_AXES_MASK;
+    bool handled = false;
+
+    if (int_source & ADXL345_INT_ACTIVITY) {
+        adxl345_push_event(priv, ADXL345_EVENT_ACTIVITY, axes, timestamp);
+        adxl345_capture_trigger(priv, ADXL345_EVENT_ACTIVITY, axes, timestamp);
+        handled = true;
+    }
+    if (int_source & ADXL345_INT_INACTIVITY) {
+        // L'inactivité porte sur tous les axes configurés, pas de source
+        adxl345_push_event(priv, ADXL345_EVENT_INACTIVITY, 0, timestamp);
+        handled = true;
+    }
+    if (int_source & ADXL345_INT_FREE_FALL) {
+        adxl345_push_event(priv, ADXL345_EVENT_FREE_FALL, 0, timestamp);
+        handled = true;
+    }
+
+    return handled;
+}
+
+/*
+ * adxl345_irq_handler - Handler primaire, en contexte d'interruption
+ *
+ * Relève l'instant d'arrivée avant le réveil du thread, dont la latence
+ * d'ordonnancement fausserait les horodatages.
+ */
+static irqreturn_t adxl345_irq_handler(int irq, void *dev_id)
+{
+    struct adxl345_data *priv = dev_id;
+
+    WRITE_ONCE(priv->irq_timestamp, ktime_get_ns());
+    return IRQ_WAKE_THREAD;
+}
+
+/*
+ * adxl345_irq_thread - Thread de INT1 : décode INT_SOURCE et traite toutes
+ * les sources, ou seulement les événements quand les données sont sur INT2
+ */
+static irqreturn_t adxl345_irq_thread(int irq, void *dev_id)
+{
+    struct adxl345_data *priv = dev_id;
+    struct device *dev = priv->dev;
+    u8 status[ADXL345_STATUS_DATA_LEN];
+    struct adxl345_record sample;
+    u8 int_source, tap_status;
+    bool data_ready;
+    u8 sources;
+    bool handled = false;
+    int loops = 0;
+    u64 timestamp;
+    u8 len;
+    int ret;
+
+    // IRQF_ONESHOT : la ligne reste masquée jusqu'à la fin du thread
+    timestamp = READ_ONCE(priv->irq_timestamp);
+    trace_adxl345_irq(priv->index, timestamp);
+
+    mutex_lock(&priv->lock);
+
+    // Avec INT2, les sources de données ont leur propre thread
+    sources = priv->irq_data ? priv->int_enable & ~ADXL345_INT_DATA_MASK : priv->int_enable;
+    data_ready = priv->data_ready && !priv->irq_data;
+
+    // L'IRQ est sur front montant : tant qu'une source reste active la ligne
+    // ne redescend pas, il faut donc relire INT_SOURCE jusqu'à ce qu'elle soit vide
+    do {
+        // ACT_TAP_STATUS..INT_SOURCE en une transaction. En mode DATA_READY la
+        // FIFO est en bypass : l'échantillon est lu dans la même transaction.
+        len = data_ready ? ADXL345_STATUS_DATA_LEN : ADXL345_STATUS_LEN;
+        ret = adxl345_read_regs(priv, ADXL345_ACT_TAP_STATUS, len, status);
+        if (ret < 0) {
+            dev_err_ratelimited(dev, "Erreur lecture INT_SOURCE: %d\n", ret);
+            break;
+        }
+        tap_status = status[0];
+        // DATA_READY/WATERMARK/OVERRUN sont positionnés même s'ils sont masqués
+        int_source = status[ADXL345_INT_SOURCE - ADXL345_ACT_TAP_STATUS] & sources;
+        if (!int_source)
+            break;
+
+        // Sources apparues pendant le traitement : pas de nouvelle entrée
+        // dans le handler primaire, elles sont datées à la relecture
+        if (loops > 0)
+            timestamp = ktime_get_ns();
+
+        if (data_ready) {
+            // Échantillon déjà lu avec le statut
+            if (int_source & ADXL345_INT_DATA_READY) {
+                adxl345_parse_sample(&status[ADXL345_DATAX0 - ADXL345_ACT_TAP_STATUS], &sample);
+                adxl345_push_samples(priv, &sample, 1, timestamp, 0);
+                handled = true;
+            }
+        } else if (int_source & ADXL345_INT_FIFO_MASK) {
+            // Watermark atteint ou FIFO pleine : vider la FIFO
+            if (int_source & ADXL345_INT_OVERRUN)
+                atomic_inc(&priv->fifo_dropped);
+
+            // Après un overrun le seuil ne désigne plus un échantillon connu
+            ret = adxl345_fifo_drain(priv, (int_source & ADXL345_INT_OVERRUN) ? 0 : timestamp);
+            if (ret < 0) {
+                dev_err_ratelimited(dev, "Erreur lecture FIFO: %d\n", ret);
+                break;
+            }
+            handled = true;
+        }
+
+        if (int_source & ADXL345_INT_TAP_MASK)
+            handled |= adxl345_handle_tap(priv, int_source, tap_status, timestamp);
+
+        if (int_source & ADXL345_INT_MOTION_MASK)
+            handled |= adxl345_handle_motion(priv, int_source, tap_status, timestamp);
+    } while (++loops < ADXL345_IRQ_MAX_LOOPS);
+
+    mutex_unlock(&priv->lock);
+
+    if (!handled) {
+        dev_dbg(dev, "Interruption non gérée\n");
+        return IRQ_NONE;
+    }
+
+    return IRQ_HANDLED;
+}
+
+static irqreturn_t adxl345_irq_data_handler(int irq, void *dev_id)
+{
+    struct adxl345_data *priv = dev_id;
+
+    WRITE_ONCE(priv->irq_data_timestamp, ktime_get_ns());
+    return IRQ_WAKE_THREAD;
+}
+
+/*
+ * adxl345_irq_data_thread - Thread de INT2, où seules les sources de
+ * données sont routées : INT_SOURCE n'est pas lu
+ *
+ * En mode DATA_READY l'échantillon est lu directement. En mode watermark
+ * FIFO_STATUS donne le nombre d'entrées, une FIFO pleine tient lieu
+ * d'overrun. La FIFO est revidée tant qu'elle atteint encore le seuil,
+ * sinon la ligne (sur front) resterait haute sans nouvelle interruption.
+ */
+static irqreturn_t adxl345_irq_data_thread(int irq, void *dev_id)
+{
+    struct adxl345_data *priv = dev_id;
+    u8 data_regs[ADXL345_DATA_LEN];
+    struct adxl345_record sample;
+    int loops = 0;
+    u64 timestamp;
+    int ret;
+
+    timestamp = READ_ONCE(priv->irq_data_timestamp);
+    trace_adxl345_irq(priv->index, timestamp);
+
+    mutex_lock(&priv->lock);
+
+    if (priv->data_ready) {
+        ret = adxl345_read_regs(priv, ADXL345_DATAX0, sizeof(data_regs), data_regs);
+        if (ret == 0) {
+            adxl345_parse_sample(data_regs, &sample);
+            adxl345_push_samples(priv, &sample, 1, timestamp, 0);
+        }
+    } else {
+        do {
+            ret = adxl345_fifo_drain(priv, loops ? 0 : timestamp);
+            if (ret == ADXL345_FIFO_DEPTH)
+                atomic_inc(&priv->fifo_dropped);
+        } while (ret >= priv->fifo_trigger && ++loops < ADXL345_IRQ_MAX_LOOPS);
+    }
+
+    mutex_unlock(&priv->lock);
+
+    if (ret < 0) {
+        dev_err_ratelimited(priv->dev, "Erreur lecture données (INT2): %d\n", ret);
+        return IRQ_NONE;
+    }
+
+    return IRQ_HANDLED;
+}
+
+/*
+ * adxl345_wait_samples - Prend read_lock avec au moins un échantillon disponible
+ *
+ * Retourne 0 avec read_lock tenu, ou une erreur (-EAGAIN en non bloquant,
+ * -ERESTARTSYS sur signal) sans le verrou.
+ */
+static int adxl345_wait_samples(struct adxl345_data *priv, struct adxl345_file *file_data, bool nonblock)
+{
+    int ret;
+
+    if (mutex_lock_interruptible(&priv->read_lock))
+        return -ERESTARTSYS;
+
+    while (kfifo_is_empty(&file_data->samples)) {
+        mutex_unlock(&priv->read_lock);
+
+        // Capteur retiré : plus rien n'arrivera après la file
+        if (READ_ONCE(priv->dead))
+            return -ENODEV;
+        if (nonblock)
+            return -EAGAIN;
+
+        ret = wait_event_interruptible(file_data->wait,
+                                       !kfifo_is_empty(&file_data->samples) || READ_ONCE(priv->dead));
+        if (ret)
+            return ret;
+
+        if (mutex_lock_interruptible(&priv->read_lock))
+            return -ERESTARTSYS;
+    }
+
+    return 0;
+}
+
+/*
+ * adxl345_read_binary - Copie autant d'enregistrements entiers que possible
+ *
+ * Les enregistrements sont copiés du kfifo vers la destination sans
+ * formatage : buffer utilisateur pour read(), pages du pipe pour splice()
+ * et sendfile(). Un enregistrement n'est retiré du kfifo qu'une fois copié.
+ * Bloque tant que la file du descripteur est vide (sauf non bloquant).
+ */
+static ssize_t adxl345_read_binary(struct adxl345_data *priv, struct adxl345_file *file_data,
+                                   struct iov_iter *to, bool nonblock)
+{
+    struct adxl345_record chunk[ADXL345_FIFO_DEPTH / 2];
+    size_t count = iov_iter_count(to) / sizeof(struct adxl345_record);
+    size_t copied = 0;
+    unsigned int n;
+    size_t bytes;
+    size_t want;
+    int ret;
+
+    if (count == 0)
+        return -EINVAL;
+
+    ret = adxl345_wait_samples(priv, file_data, nonblock);
+    if (ret)
+        return ret;
+
+    while (copied < count) {
+        n = kfifo_out_peek(&file_data->samples, chunk, min_t(size_t, count - copied, ARRAY_SIZE(chunk)));
+        if (!n)
+            break;
+
+        want = n * sizeof(chunk[0]);
+        bytes = copy_to_iter(chunk, want, to);
+        kfifo_out(&file_data->samples, chunk, bytes / sizeof(chunk[0]));
+        copied += bytes / sizeof(chunk[0]);
+        // Faute sur le buffer utilisateur : s'arrêter à ce qui est passé
+        if (bytes < want)
+            break;
+    }
+
+    mutex_unlock(&priv->read_lock);
+
+    return copied ? copied * sizeof(struct adxl345_record) : -EFAULT;
+}
+
+/*
+ * adxl345_format_line - Ligne texte d'un échantillon, en g
+ * Retourne la longueur de la ligne écrite dans output (ADXL345_LINE_MAX).
+ */
+static unsigned int adxl345_format_line(struct adxl345_data *priv, const struct adxl345_record *rec,
+                                        char *output)
+{
+    s16 raw_x, raw_y, raw_z; // Valeurs brutes signées
+    unsigned int abs_x, abs_y, abs_z;
+    char sign_x, sign_y, sign_z;
+    unsigned int len;
+    u32 scale;
+
+    raw_x = rec->x;
+    raw_y = rec->y;
+    raw_z = rec->z;
+
+    // Gestion des signes et valeurs absolues
+    sign_x = raw_x < 0 ? '-' : '+';
+    sign_y = raw_y < 0 ? '-' : '+';
+    sign_z = raw_z < 0 ? '-' : '+';
+    abs_x = abs(raw_x);
+    abs_y = abs(raw_y);
+    abs_z = abs(raw_z);
+
+    // Conversion en millig (mg) avec l'échelle en vigueur à l'acquisition
+    // (ex. ±4 g sur 10 bits : 7.8 mg/LSB), une multiplication et un décalage
+    scale = adxl345_scale_mg_q10[rec->flags & ADXL345_RECORD_SCALE_MASK];
+    abs_x = (abs_x * scale) >> ADXL345_SCALE_SHIFT;
+    abs_y = (abs_y * scale) >> ADXL345_SCALE_SHIFT;
+    abs_z = (abs_z * scale) >> ADXL345_SCALE_SHIFT;
+
+    // Formatage de sortie (X = -1.234 g)
+    len = snprintf(output, ADXL345_LINE_MAX,
+                  "X = %c%u.%03u; Y = %c%u.%03u; Z = %c%u.%03u\n",
+                  sign_x, abs_x / 1000, abs_x % 1000,
+                  sign_y, abs_y / 1000, abs_y % 1000,
+                  sign_z, abs_z / 1000, abs_z % 1000);
+
+    // Gestion des erreurs de snprintf
+    if (len >= ADXL345_LINE_MAX) {
+        dev_warn_ratelimited(priv->dev, "Troncation de la sortie (%u > %d)\n", len, ADXL345_LINE_MAX);
+        len = ADXL345_LINE_MAX - 1;
+    }
+
+    return len;
+}
+
+/*
+ * adxl345_last_sample_fresh - Vrai si last_sample vient de l'acquisition en cours
+ *
+ * En marche, une salve arrive au moins toutes les ADXL345_MAX_BATCH_MS (ou à
+ * chaque échantillon aux très bas débits). Au-delà, last_sample date d'avant
+ * une mise en veille. Sans verrou : utilisable comme condition d'attente.
+ */
+static bool adxl345_last_sample_fresh(struct adxl345_data *priv)
+{
+    u64 timestamp = READ_ONCE(priv->last_sample.timestamp_ns);
+    u64 max_age = (u64)ADXL345_MAX_BATCH_MS * NSEC_PER_MSEC + READ_ONCE(priv->sample_period_ns);
+
+    return timestamp && (s64)(ktime_get_ns() - timestamp) <= (s64)max_age;
+}
+
+/*
+ * adxl345_read_text - Ligne formatée du dernier échantillon, puis EOF
+ *
+ * Attend seulement si le dernier échantillon est périmé (capteur qui sort
+ * de veille à l'ouverture du descripteur).
+ */
+static ssize_t adxl345_read_text(struct adxl345_file *file_data, struct iov_iter *to, loff_t *ppos,
+                                 bool nonblock)
+{
+    struct adxl345_data *priv = file_data->priv;
+    char output[ADXL345_LINE_MAX];
+    size_t count = iov_iter_count(to);
+    unsigned int len;
+    int ret;
+
+    if (*ppos == 0) {
+        // Nouvelle ligne : prendre l'échantillon le plus récent
+        if (!adxl345_last_sample_fresh(priv)) {
+            if (nonblock)
+                return -EAGAIN;
+            ret = wait_event_interruptible(priv->read_queue,
+                                           adxl345_last_sample_fresh(priv) || READ_ONCE(priv->dead));
+            if (ret)
+                return ret;
+            if (!adxl345_last_sample_fresh(priv))
+                return -ENODEV;
+        }
+
+        if (mutex_lock_interruptible(&priv->lock))
+            return -ERESTARTSYS;
+        file_data->last = priv->last_sample;
+        mutex_unlock(&priv->lock);
+    }
+
+    // Une lecture partielle continue la ligne de l'échantillon déjà pris
+    len = adxl345_format_line(priv, &file_data->last, output);
+
+    // Gestion de la position de lecture
+    if (*ppos >= len)
+        return 0;
+
+    if (count > len - *ppos)
+        count = len - *ppos;
+
+    if (copy_to_iter(output + *ppos, count, to) != count)
+        return -EFAULT;
+
+    *ppos += count;
+    return count;
+}
+
+/*
+ * adxl345_read_stream - Lignes texte en continu, jamais de fin de fichier
+ *
+ * Bloque (sauf O_NONBLOCK : -EAGAIN) seulement si aucune ligne n'est prête,
+ * puis copie autant de lignes que le buffer et le ring en contiennent. Une
+ * ligne coupée par la taille du buffer est terminée au read() suivant.
+ * La position du fichier est ignorée.
+ */
+static ssize_t adxl345_read_stream(struct adxl345_file *file_data, struct iov_iter *to, bool nonblock)
+{
+    struct adxl345_data *priv = file_data->priv;
+    size_t count = iov_iter_count(to);
+    struct adxl345_record rec;
+    size_t copied = 0;
+    size_t chunk;
+    int ret;
+
+    if (file_data->line_pos < file_data->line_len) {
+        if (mutex_lock_interruptible(&priv->read_lock))
+            return -ERESTARTSYS;
+    } else {
+        ret = adxl345_wait_samples(priv, file_data, nonblock);
+        if (ret)
+            return ret;
+    }
+
+    while (copied < count) {
+        if (file_data->line_pos == file_data->line_len) {
+            if (!kfifo_out(&file_data->samples, &rec, 1))
+                break;
+            file_data->line_len = adxl345_format_line(priv, &rec, file_data->line);
+            file_data->line_pos = 0;
+        }
+
+        chunk = min_t(size_t, count - copied, file_data->line_len - file_data->line_pos);
+        if (copy_to_iter(file_data->line + file_data->line_pos, chunk, to) != chunk) {
+            mutex_unlock(&priv->read_lock);
+            return copied ? copied : -EFAULT;
+        }
+        copied += chunk;
+        file_data->line_pos += chunk;
+    }
+
+    mutex_unlock(&priv->read_lock);
+    return copied;
+}
+
+/*
+ * adxl345_read_iter - read(), readv() et, via generic_file_splice_read,
+ * splice()/sendfile() : le pipe reçoit directement les enregistrements
+ * binaires du ring, sans passage par un buffer utilisateur
+ */
+static ssize_t adxl345_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    struct adxl345_file *file_data = iocb->ki_filp->private_data;
+    // SPLICE_F_NONBLOCK n'est pas propagé : O_NONBLOCK ou IOCB_NOWAIT
+    bool nonblock = (iocb->ki_filp->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT);
+    ssize_t ret;
+
+    if (!iov_iter_count(to))
+        return 0;
+
+    if (file_data->mode == ADXL345_MODE_BINARY)
+        ret = adxl345_read_binary(file_data->priv, file_data, to, nonblock);
+    else if (file_data->mode == ADXL345_MODE_STREAM)
+        ret = adxl345_read_stream(file_data, to, nonblock);
+    else
+        ret = adxl345_read_text(file_data, to, &iocb->ki_pos, nonblock);
+
+    trace_adxl345_read_done(file_data->priv->index, false, ret);
+    return ret;
+}
+
+static int adxl345_open(struct inode *inode, struct file *file)
+{
+    // misc_open() a placé le miscdevice dans private_data
+    struct adxl345_data *priv = container_of(file->private_data, struct adxl345_data, miscdev);
+    struct adxl345_file *file_data;
+    int ret;
+
+    file_data = kzalloc(sizeof(*file_data), GFP_KERNEL);
+    if (!file_data)
+        return -ENOMEM;
+
+    // Sortie de standby tant que le fichier est ouvert
+    ret = adxl345_pm_get(priv);
+    if (ret < 0) {
+        kfree(file_data);
+        return ret;
+    }
+
+    // File propre au descripteur : un lecteur ne prend rien aux autres
+    ret = kfifo_alloc(&file_data->samples, ADXL345_RING_SIZE, GFP_KERNEL);
+    if (ret) {
+        adxl345_pm_put(priv);
+        kfree(file_data);
+        return ret;
+    }
+
+    // misc_open() tient misc_mtx : le remove n'a pas encore désenregistré
+    // le device, la référence du probe est toujours là
+    kref_get(&priv->kref);
+    file_data->priv = priv;
+    file_data->mode = READ_ONCE(priv->default_mode);
+    init_waitqueue_head(&file_data->wait);
+    file->private_data = file_data;
+
+    mutex_lock(&priv->lock);
+    list_add_tail(&file_data->reader_node, &priv->readers);
+    mutex_unlock(&priv->lock);
+
+    return 0;
+}
+
+static int adxl345_release(struct inode *inode, struct file *file)
+{
+    struct adxl345_file *file_data = file->private_data;
+    struct adxl345_data *priv = file_data->priv;
+
+    // Le dernier munmap() a eu lieu : l'anneau redevient libre
+    mutex_lock(&priv->lock);
+    if (priv->ring_owner == file_data)
+        priv->ring_owner = NULL;
+    // Plus de salves vers la file du descripteur
+    list_del(&file_data->reader_node);
+    mutex_unlock(&priv->lock);
+
+    kfifo_free(&file_data->samples);
+
+    adxl345_pm_put(priv);
+    kfree(file_data);
+    adxl345_put_data(priv);
+    return 0;
+}
+
+/*
+ * adxl345_ring_is_empty - Vrai si l'application a tout consommé
+ */
+static bool adxl345_ring_is_empty(struct adxl345_data *priv)
+{
+    return smp_load_acquire(&priv->ring_hdr->head) == READ_ONCE(priv->ring_hdr->tail);
+}
+
+static __poll_t adxl345_poll(struct file *file, poll_table *wait)
+{
+    struct adxl345_file *file_data = file->private_data;
+    struct adxl345_data *priv = file_data->priv;
+    __poll_t mask = 0;
+
+    poll_wait(file, &priv->read_queue, wait);
+    poll_wait(file, &file_data->wait, wait);
+
+    if (READ_ONCE(priv->dead))
+        mask |= EPOLLHUP | EPOLLERR;
+
+    // Le propriétaire de l'anneau mmap ne lit pas le kfifo
+    if (READ_ONCE(priv->ring_owner) == file_data) {
+        if (!adxl345_ring_is_empty(priv))
+            mask |= EPOLLIN | EPOLLRDNORM;
+    } else if (READ_ONCE(file_data->mode) == ADXL345_MODE_TEXT) {
+        if (adxl345_last_sample_fresh(priv))
+            mask |= EPOLLIN | EPOLLRDNORM;
+    } else if (!kfifo_is_empty(&file_data->samples) ||
+               READ_ONCE(file_data->line_pos) < READ_ONCE(file_data->line_len)) {
+        // Mode stream : la fin d'une ligne coupée est lisible sans attendre
+        mask |= EPOLLIN | EPOLLRDNORM;
+    }
+
+    return mask;
+}
+
+/*
+ * adxl345_mmap - Projette l'anneau d'échantillons en espace utilisateur
+ *
+ * L'anneau est alloué au premier appel et conservé jusqu'à la libération
+ * de priv, après le dernier munmap() et la fermeture du dernier fichier.
+ * Un seul descripteur peut en être propriétaire (un seul consommateur).
+ */
+static int adxl345_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct adxl345_file *file_data = file->private_data;
+    struct adxl345_data *priv = file_data->priv;
+    unsigned long size = vma->vm_end - vma->vm_start;
+    int ret;
+
+    if (vma->vm_pgoff != 0 || size > PAGE_ALIGN(ADXL345_MMAP_BYTES))
+        return -EINVAL;
+
+    ret = adxl345_lock_live(priv);
+    if (ret)
+        return ret;
+
+    if (priv->ring_owner && priv->ring_owner != file_data) {
+        mutex_unlock(&priv->lock);
+        return -EBUSY;
+    }
+
+    if (!priv->ring) {
+        priv->ring = vmalloc_user(ADXL345_MMAP_BYTES);
+        if (!priv->ring) {
+            mutex_unlock(&priv->lock);
+            return -ENOMEM;
+        }
+        priv->ring_hdr = priv->ring;
+        priv->ring_records = priv->ring + ADXL345_MMAP_DATA_OFFSET;
+    }
+
+    ret = remap_vmalloc_range(vma, priv->ring, 0);
+    if (ret) {
+        mutex_unlock(&priv->lock);
+        return ret;
+    }
+
+    // Nouveau propriétaire : repartir d'un anneau vide
+    if (!priv->ring_owner) {
+        memset(priv->ring_hdr, 0, sizeof(*priv->ring_hdr));
+        priv->ring_hdr->size = ADXL345_MMAP_RING_SIZE;
+        priv->ring_hdr->data_offset = ADXL345_MMAP_DATA_OFFSET;
+        priv->ring_hdr->record_size = sizeof(struct adxl345_record);
+        priv->ring_owner = file_data;
+    }
+
+    mutex_unlock(&priv->lock);
+    return 0;
+}
+
+/*
+ * adxl345_set_filter - Active, change ou retire le filtre d'un descripteur
+ *
+ * Les échantillons non encore lus de la file du descripteur sont abandonnés :
+ * ils ne sont pas passés par le nouveau filtre.
+ */
+static int adxl345_set_filter(struct adxl345_file *file_data, const struct adxl345_filter *filter)
+{
+    struct adxl345_data *priv = file_data->priv;
+
+    switch (filter->type) {
+    case ADXL345_FILTER_NONE:
+        break;
+    case ADXL345_FILTER_LOWPASS:
+        if (filter->shift < 1 || filter->shift > ADXL345_FILTER_MAX_SHIFT)
+            return -EINVAL;
+        fallthrough;
+    case ADXL345_FILTER_AVERAGE:
+    case ADXL345_FILTER_DECIMATE:
+        if (filter->factor < 1 || filter->factor > ADXL345_FILTER_MAX_FACTOR)
+            return -EINVAL;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    if (mutex_lock_interruptible(&priv->read_lock))
+        return -ERESTARTSYS;
+
+    mutex_lock(&priv->lock);
+    memset(&file_data->filter, 0, sizeof(file_data->filter));
+    if (filter->type != ADXL345_FILTER_NONE)
+        file_data->filter = *filter;
+    file_data->filter_primed = false;
+    kfifo_reset(&file_data->samples);
+    file_data->line_len = file_data->line_pos = 0;
+    mutex_unlock(&priv->lock);
+
+    mutex_unlock(&priv->read_lock);
+    return 0;
+}
+
+/*
+ * adxl345_set_mode - Change le mode de lecture d'un descripteur
+ *
+ * La file et la ligne en cours repartent de zéro : un passage par le mode
+ * texte ne laisse pas d'échantillons anciens à relire.
+ */
+static int adxl345_set_mode(struct adxl345_file *file_data, int mode)
+{
+    struct adxl345_data *priv = file_data->priv;
+
+    if (mutex_lock_interruptible(&priv->read_lock))
+        return -ERESTARTSYS;
+
+    mutex_lock(&priv->lock);
+    if (file_data->mode != mode) {
+        WRITE_ONCE(file_data->mode, mode);
+        kfifo_reset(&file_data->samples);
+        file_data->line_len = file_data->line_pos = 0;
+    }
+    mutex_unlock(&priv->lock);
+
+    mutex_unlock(&priv->read_lock);
+    return 0;
+}
+
+static long adxl345_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct adxl345_file *file_data = file->private_data;
+    struct adxl345_data *priv = file_data->priv;
+    struct adxl345_filter filter;
+    struct adxl345_offsets ofs = { 0 };
+    s8 val[ADXL345_OFS_LEN];
+    int range;
+    int ret;
+
+    switch (cmd) {
+    case ADXL345_IOC_SET_MODE:
+        if (arg != ADXL345_MODE_TEXT && arg != ADXL345_MODE_BINARY && arg != ADXL345_MODE_STREAM)
+            return -EINVAL;
+        return adxl345_set_mode(file_data, arg);
+
+    case ADXL345_IOC_GET_MODE:
+        return put_user(file_data->mode, (int __user *)arg);
+
+    case ADXL345_IOC_RING_SIZE:
+        return put_user((int)PAGE_ALIGN(ADXL345_MMAP_BYTES), (int __user *)arg);
+
+    case ADXL345_IOC_SET_ODR:
+        if (arg == 0 || arg > adxl345_odr_mhz[ARRAY_SIZE(adxl345_odr_mhz) - 1])
+            return -EINVAL;
+        ret = adxl345_lock_live(priv);
+        if (ret)
+            return ret;
+        ret = adxl345_set_rate(priv, adxl345_odr_to_code(arg), priv->low_power);
+        mutex_unlock(&priv->lock);
+        return ret;
+
+    case ADXL345_IOC_GET_ODR:
+        return put_user((int)adxl345_odr_mhz[READ_ONCE(priv->odr_code)], (int __user *)arg);
+
+    case ADXL345_IOC_SET_LOW_POWER:
+        ret = adxl345_lock_live(priv);
+        if (ret)
+            return ret;
+        ret = adxl345_set_rate(priv, priv->odr_code, !!arg);
+        mutex_unlock(&priv->lock);
+        return ret;
+
+    case ADXL345_IOC_SET_RANGE:
+        ret = adxl345_g_to_range(arg);
+        if (ret < 0)
+            return ret;
+        range = ret;
+        ret = adxl345_lock_live(priv);
+        if (ret)
+            return ret;
+        ret = adxl345_set_format(priv, range, priv->full_res);
+        mutex_unlock(&priv->lock);
+        return ret;
+
+    case ADXL345_IOC_GET_RANGE:
+        return put_user(2 << READ_ONCE(priv->range), (int __user *)arg);
+
+    case ADXL345_IOC_SET_FULL_RES:
+        ret = adxl345_lock_live(priv);
+        if (ret)
+            return ret;
+        ret = adxl345_set_format(priv, priv->range, !!arg);
+        mutex_unlock(&priv->lock);
+        return ret;
+
+    case ADXL345_IOC_GET_FULL_RES:
+        return put_user((int)READ_ONCE(priv->full_res), (int __user *)arg);
+
+    case ADXL345_IOC_SET_FILTER:
+        if (copy_from_user(&filter, (void __user *)arg, sizeof(filter)))
+            return -EFAULT;
+        return adxl345_set_filter(file_data, &filter);
+
+    case ADXL345_IOC_GET_FILTER:
+        mutex_lock(&priv->read_lock);
+        filter = file_data->filter;
+        mutex_unlock(&priv->read_lock);
+        if (copy_to_user((void __user *)arg, &filter, sizeof(filter)))
+            return -EFAULT;
+        break;
+
+    case ADXL345_IOC_CALIBRATE:
+        if (arg > ADXL345_CALIB_MAX_SAMPLES)
+            return -EINVAL;
+        return adxl345_calibrate(priv, arg, NULL);
+
+    case ADXL345_IOC_GET_OFFSETS:
+        ret = adxl345_lock_live(priv);
+        if (ret)
+            return ret;
+        ret = adxl345_get_offsets(priv, val);
+        mutex_unlock(&priv->lock);
+        if (ret < 0)
+            return ret;
+        ofs.x = val[0];
+        ofs.y = val[1];
+        ofs.z = val[2];
+        if (copy_to_user((void __user *)arg, &ofs, sizeof(ofs)))
+            return -EFAULT;
+        break;
+
+    case ADXL345_IOC_SET_OFFSETS:
+        if (copy_from_user(&ofs, (void __user *)arg, sizeof(ofs)))
+            return -EFAULT;
+        val[0] = ofs.x;
+        val[1] = ofs.y;
+        val[2] = ofs.z;
+        ret = adxl345_lock_live(priv);
+        if (ret)
+            return ret;
+        ret = adxl345_set_offsets(priv, val);
+        mutex_unlock(&priv->lock);
+        return ret;
+
+    default:
+        return -ENOTTY;
+    }
+
+    return 0;
+}
+
+static const struct file_operations adxl345_fops = {
+    .owner = THIS_MODULE,
+    .open = adxl345_open,
+    .release = adxl345_release,
+    .read_iter = adxl345_read_iter,
+    .splice_read = generic_file_splice_read,
+    .unlocked_ioctl = adxl345_ioctl,
+    .poll = adxl345_poll,
+    .mmap = adxl345_mmap,
+};
+
+// Descripteur ouvert sur /dev/adxl345_events
+struct adxl345_event_file {
+    struct adxl345_data *priv;
+    struct adxl345_subscriber sub;
+    struct mutex read_lock;   // Entre le peek et le retrait des événements
+};
+
+static int adxl345_event_open(struct inode *inode, struct file *file)
+{
+    struct adxl345_data *priv = container_of(file->private_data, struct adxl345_data, event_miscdev);
+    struct adxl345_event_file *evf;
+    int ret;
+
+    evf = kzalloc(sizeof(*evf), GFP_KERNEL);
+    if (!evf)
+        return -ENOMEM;
+
+    ret = adxl345_pm_get(priv);
+    if (ret < 0) {
+        kfree(evf);
+        return ret;
+    }
+
+    kref_get(&priv->kref);
+    evf->priv = priv;
+    mutex_init(&evf->read_lock);
+    adxl345_subscribe(priv, &evf->sub);
+    file->private_data = evf;
+
+    return 0;
+}
+
+static int adxl345_event_release(struct inode *inode, struct file *file)
+{
+    struct adxl345_event_file *evf = file->private_data;
+
+    struct adxl345_data *priv = evf->priv;
+
+    adxl345_unsubscribe(priv, &evf->sub);
+    adxl345_pm_put(priv);
+    mutex_destroy(&evf->read_lock);
+    kfree(evf);
+    adxl345_put_data(priv);
+    return 0;
+}
+
+/*
+ * adxl345_event_read - Retourne autant d'événements entiers que possible
+ *
+ * Bloque jusqu'au premier événement, sauf en O_NONBLOCK (-EAGAIN). Un
+ * événement ne quitte la file qu'une fois copié : une faute sur le buffer
+ * ne perd rien.
+ */
+static ssize_t adxl345_event_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct adxl345_event_file *evf = file->private_data;
+    struct adxl345_data *priv = evf->priv;
+    struct adxl345_event events[16];
+    unsigned int max, n;
+    size_t bytes;
+    int ret;
+
+    max = min_t(size_t, count / sizeof(events[0]), ARRAY_SIZE(events));
+    if (max == 0)
+        return -EINVAL;
+
+    if (mutex_lock_interruptible(&evf->read_lock))
+        return -ERESTARTSYS;
+
+    while (!(n = adxl345_peek_events(priv, &evf->sub, events, max))) {
+        mutex_unlock(&evf->read_lock);
+
+        if (READ_ONCE(priv->dead))
+            return -ENODEV;
+        if (file->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+
+        ret = wait_event_interruptible(priv->wait_queue,
+                                       !kfifo_is_empty(&evf->sub.events) || READ_ONCE(priv->dead));
+        if (ret)
+            return ret;
+
+        if (mutex_lock_interruptible(&evf->read_lock))
+            return -ERESTARTSYS;
+    }
+
+    // Ne retirer que les événements entièrement copiés
+    bytes = n * sizeof(events[0]);
+    bytes -= copy_to_user(buf, events, bytes);
+    n = bytes / sizeof(events[0]);
+    adxl345_skip_events(priv, &evf->sub, n);
+
+    mutex_unlock(&evf->read_lock);
+
+    if (!n)
+        return -EFAULT;
+
+    trace_adxl345_read_done(priv->index, true, n * sizeof(events[0]));
+    return n * sizeof(events[0]);
+}
+
+static __poll_t adxl345_event_poll(struct file *file, poll_table *wait)
+{
+    struct adxl345_event_file *evf = file->private_data;
+
+    __poll_t mask = 0;
+
+    poll_wait(file, &evf->priv->wait_queue, wait);
+
+    if (READ_ONCE(evf->priv->dead))
+        mask |= EPOLLHUP | EPOLLERR;
+    if (!kfifo_is_empty(&evf->sub.events))
+        mask |= EPOLLIN | EPOLLRDNORM;
+
+    return mask;
+}
+
+static long adxl345_event_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct adxl345_event_file *evf = file->private_data;
+    u32 overflow;
+
+    switch (cmd) {
+    case ADXL345_IOC_EVT_OVERFLOW:
+        spin_lock_irq(&evf->priv->event_lock);
+        overflow = evf->sub.overflow;
+        spin_unlock_irq(&evf->priv->event_lock);
+        return put_user(overflow, (u32 __user *)arg);
+
+    default:
+        return -ENOTTY;
+    }
+}
+
+static const struct file_operations adxl345_event_fops = {
+    .owner = THIS_MODULE,
+    .open = adxl345_event_open,
+    .release = adxl345_event_release,
+    .read = adxl345_event_read,
+    .poll = adxl345_event_poll,
+    .unlocked_ioctl = adxl345_event_ioctl,
+};
+
+/*
+ * adxl345_group_next - Capteur dont l'échantillon en tête est le plus ancien
+ *
+ * L'échantillon n'est retourné que si aucun autre capteur actif ne peut
+ * encore produire un échantillon plus ancien : sa file n'est pas vide ou
+ * son dernier horodatage publié est déjà postérieur.
+ */
+static struct adxl345_group_member *adxl345_group_next(struct adxl345_group *group)
+{
+    struct adxl345_group_member *best = NULL;
+    struct adxl345_record head, best_head;
+    unsigned int i;
+
+    for (i = 0; i < group->count; i++) {
+        if (!kfifo_peek(&group->members[i].samples, &head))
+            continue;
+        if (!best || head.timestamp_ns < best_head.timestamp_ns) {
+            best = &group->members[i];
+            best_head = head;
+        }
+    }
+
+    if (!best)
+        return NULL;
+
+    for (i = 0; i < group->count; i++) {
+        struct adxl345_group_member *member = &group->members[i];
+
+        if (READ_ONCE(member->detached) || !kfifo_is_empty(&member->samples))
+            continue;
+        if (READ_ONCE(member->last_ts) < best_head.timestamp_ns)
+            return NULL;
+    }
+
+    return best;
+}
+
+/*
+ * adxl345_group_start - Redémarre les FIFO de tous les capteurs ensemble
+ *
+ * Les FIFO passent d'abord toutes en bypass (ce qui les vide), puis toutes
+ * en stream : l'écart au démarrage se limite à quelques transactions I2C.
+ * Appelée avec adxl345_group_lock.
+ */
+static void adxl345_group_start(struct adxl345_group *group)
+{
+    struct adxl345_data *priv;
+    unsigned int i;
+
+    for (i = 0; i < group->count; i++) {
+        priv = group->members[i].priv;
+
+        mutex_lock(&priv->lock);
+        // Les échantillons déjà acquis restent aux lecteurs habituels
+        if (!priv->data_ready) {
+            adxl345_fifo_drain(priv, 0);
+            adxl345_write_reg(priv, ADXL345_FIFO_CTL, ADXL345_FIFO_BYPASS);
+        }
+        priv->group_member = &group->members[i];
+        mutex_unlock(&priv->lock);
+    }
+
+    for (i = 0; i < group->count; i++) {
+        priv = group->members[i].priv;
+
+        mutex_lock(&priv->lock);
+        if (!priv->data_ready)
+            adxl345_write_fifo_ctl(priv);
+        mutex_unlock(&priv->lock);
+    }
+}
+
+/*
+ * adxl345_group_detach - Retire un capteur de la capture groupée
+ *
+ * Appelée avec adxl345_group_lock, à la fermeture du groupe ou au retrait
+ * du capteur.
+ */
+static void adxl345_group_detach(struct adxl345_group_member *member)
+{
+    struct adxl345_data *priv = member->priv;
+
+    mutex_lock(&priv->lock);
+    priv->group_member = NULL;
+    mutex_unlock(&priv->lock);
+
+    adxl345_pm_put(priv);
+    member->priv = NULL;
+    WRITE_ONCE(member->detached, true);
+    wake_up_interruptible(&adxl345_group_wait);
+}
+
+static int adxl345_group_open(struct inode *inode, struct file *file)
+{
+    struct adxl345_group *group;
+    struct adxl345_data *priv;
+    unsigned int count = 0;
+    unsigned int i = 0;
+    int ret;
+
+    mutex_lock(&adxl345_group_lock);
+
+    if (adxl345_group_active) {
+        ret = -EBUSY;
+        goto out_unlock;
+    }
+
+    list_for_each_entry(priv, &adxl345_instances, node)
+        count++;
+    if (!count) {
+        ret = -ENODEV;
+        goto out_unlock;
+    }
+
+    group = kzalloc(struct_size(group, members, count), GFP_KERNEL);
+    if (!group) {
+        ret = -ENOMEM;
+        goto out_unlock;
+    }
+
+    mutex_init(&group->read_lock);
+    group->count = count;
+
+    list_for_each_entry(priv, &adxl345_instances, node) {
+        ret = adxl345_pm_get(priv);
+        if (ret < 0)
+            goto err_pm;
+
+        INIT_KFIFO(group->members[i].samples);
+        group->members[i].priv = priv;
+        i++;
+    }
+
+    adxl345_group_start(group);
+    adxl345_group_active = group;
+    file->private_data = group;
+
+    mutex_unlock(&adxl345_group_lock);
+    return 0;
+
+err_pm:
+    while (i--)
+        adxl345_pm_put(group->members[i].priv);
+    kfree(group);
+out_unlock:
+    mutex_unlock(&adxl345_group_lock);
+    return ret;
+}
+
+static int adxl345_group_release(struct inode *inode, struct file *file)
+{
+    struct adxl345_group *group = file->private_data;
+    unsigned int i;
+
+    mutex_lock(&adxl345_group_lock);
+    for (i = 0; i < group->count; i++) {
+        if (group->members[i].priv)
+            adxl345_group_detach(&group->members[i]);
+    }
+    adxl345_group_active = NULL;
+    mutex_unlock(&adxl345_group_lock);
+
+    mutex_destroy(&group->read_lock);
+    kfree(group);
+    return 0;
+}
+
+/*
+ * adxl345_group_read - Échantillons de tous les capteurs, par ordre de timestamp
+ */
+static ssize_t adxl345_group_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct adxl345_group *group = file->private_data;
+    struct adxl345_group_member *member;
+    struct adxl345_record records[32];
+    unsigned int max, n = 0;
+    int ret;
+
+    max = min_t(size_t, count / sizeof(records[0]), ARRAY_SIZE(records));
+    if (max == 0)
+        return -EINVAL;
+
+    if (mutex_lock_interruptible(&group->read_lock))
+        return -ERESTARTSYS;
+
+    while (!adxl345_group_next(group)) {
+        mutex_unlock(&group->read_lock);
+
+        if (file->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+
+        ret = wait_event_interruptible(adxl345_group_wait, adxl345_group_next(group));
+        if (ret)
+            return ret;
+
+        if (mutex_lock_interruptible(&group->read_lock))
+            return -ERESTARTSYS;
+    }
+
+    while (n < max && (member = adxl345_group_next(group)))
+        n += kfifo_out(&member->samples, &records[n], 1);
+
+    mutex_unlock(&group->read_lock);
+
+    if (copy_to_user(buf, records, n * sizeof(records[0])))
+        return -EFAULT;
+
+    return n * sizeof(records[0]);
+}
+
+static __poll_t adxl345_group_poll(struct file *file, poll_table *wait)
+{
+    struct adxl345_group *group = file->private_data;
+
+    poll_wait(file, &adxl345_group_wait, wait);
+
+    return adxl345_group_next(group) ? EPOLLIN | EPOLLRDNORM : 0;
+}
+
+static const struct file_operations adxl345_group_fops = {
+    .owner = THIS_MODULE,
+    .open = adxl345_group_open,
+    .release = adxl345_group_release,
+    .read = adxl345_group_read,
+    .poll = adxl345_group_poll,
+};
+
+static struct miscdevice adxl345_group_miscdev = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name = GROUP_NAME,
+    .fops = &adxl345_group_fops,
+};
+
+/*
+ * Interface IIO
+ *
+ * Le flux de la FIFO matérielle alimente aussi un buffer kfifo IIO : le
+ * watermark joue le rôle de déclencheur, chaque salve vidée par le thread
+ * d'IRQ est poussée d'un bloc (voir adxl345_iio_push()).
+ */
+static struct adxl345_data *adxl345_iio_priv(struct iio_dev *indio_dev)
+{
+    return *(struct adxl345_data **)iio_priv(indio_dev);
+}
+
+#define ADXL345_IIO_CHANNEL(index, axis) {                                  \
+    .type = IIO_ACCEL,                                                      \
+    .modified = 1,                                                          \
+    .channel2 = IIO_MOD_##axis,                                             \
+    .address = index,                                                       \
+    .info_mask_separate = BIT(IIO_CHAN_INFO_RAW),                           \
+    .info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE) |                  \
+        BIT(IIO_CHAN_INFO_SAMP_FREQ),                                       \
+    .info_mask_shared_by_type_available = BIT(IIO_CHAN_INFO_SCALE) |        \
+        BIT(IIO_CHAN_INFO_SAMP_FREQ),                                       \
+    .scan_index = index,                                                    \
+    .scan_type = {                                                          \
+        .sign = 's',                                                        \
+        .realbits = 13,                                                     \
+        .storagebits = 16,                                                  \
+        .endianness = IIO_CPU,                                              \
+    },                                                                      \
+}
+
+static const struct iio_chan_spec adxl345_iio_channels[] = {
+    ADXL345_IIO_CHANNEL(0, X),
+    ADXL345_IIO_CHANNEL(1, Y),
+    ADXL345_IIO_CHANNEL(2, Z),
+    IIO_CHAN_SOFT_TIMESTAMP(3),
+};
+
+// Les trois axes sont toujours lus ensemble, le cœur IIO fait le tri
+static const unsigned long adxl345_iio_scan_masks[] = { 0x7, 0 };
+
+// Débits de BW_RATE au format IIO_VAL_INT_PLUS_MICRO
+static const int adxl345_iio_odr_avail[][2] = {
+    { 0, 100000 }, { 0, 200000 }, { 0, 390000 }, { 0, 780000 },
+    { 1, 560000 }, { 3, 130000 }, { 6, 250000 }, { 12, 500000 },
+    { 25, 0 }, { 50, 0 }, { 100, 0 }, { 200, 0 },
+    { 400, 0 }, { 800, 0 }, { 1600, 0 }, { 3200, 0 },
+};
+
+// adxl345_scale_nano au format IIO_VAL_INT_PLUS_NANO
+static const int adxl345_iio_scale_avail[] = {
+    0, 38245935, 0, 76491870, 0, 152983740, 0, 305967480,
+};
+
+static int adxl345_iio_read_raw(struct iio_dev *indio_dev, struct iio_chan_spec const *chan,
+                                int *val, int *val2, long mask)
+{
+    struct adxl345_data *priv = adxl345_iio_priv(indio_dev);
+    u32 mhz;
+
+    switch (mask) {
+    case IIO_CHAN_INFO_RAW:
+        // Le capteur échantillonne en continu : une lecture directe du
+        // registre de données dépilerait la FIFO, on rend le dernier échantillon
+        mutex_lock(&priv->lock);
+        switch (chan->address) {
+        case 0: *val = priv->last_sample.x; break;
+        case 1: *val = priv->last_sample.y; break;
+        default: *val = priv->last_sample.z; break;
+        }
+        mutex_unlock(&priv->lock);
+        return IIO_VAL_INT;
+
+    case IIO_CHAN_INFO_SCALE:
+        *val = 0;
+        *val2 = adxl345_scale_nano[READ_ONCE(priv->scale_idx)];
+        return IIO_VAL_INT_PLUS_NANO;
+
+    case IIO_CHAN_INFO_SAMP_FREQ:
+        mutex_lock(&priv->lock);
+        mhz = adxl345_odr_mhz[priv->odr_code];
+        mutex_unlock(&priv->lock);
+        *val = mhz / 1000;
+        *val2 = (mhz % 1000) * 1000;
+        return IIO_VAL_INT_PLUS_MICRO;
+
+    default:
+        return -EINVAL;
+    }
+}
+
+static int adxl345_iio_write_raw(struct iio_dev *indio_dev, struct iio_chan_spec const *chan,
+                                 int val, int val2, long mask)
+{
+    struct adxl345_data *priv = adxl345_iio_priv(indio_dev);
+    unsigned int i;
+    int ret;
+
+    switch (mask) {
+    case IIO_CHAN_INFO_SCALE:
+        // Choisir une échelle revient à choisir la plage en 10 bits
+        if (val != 0)
+            return -EINVAL;
+        for (i = 0; i < ARRAY_SIZE(adxl345_scale_nano); i++) {
+            if (adxl345_scale_nano[i] == val2)
+                break;
+        }
+        if (i == ARRAY_SIZE(adxl345_scale_nano))
+            return -EINVAL;
+
+        mutex_lock(&priv->lock);
+        ret = adxl345_set_format(priv, i, false);
+        mutex_unlock(&priv->lock);
+        return ret;
+
+    case IIO_CHAN_INFO_SAMP_FREQ:
+        if (val < 0 || val > 3200 || val2 < 0)
+            return -EINVAL;
+
+        mutex_lock(&priv->lock);
+        ret = adxl345_set_rate(priv, adxl345_odr_to_code(val * 1000 + val2 / 1000),
+                               priv->low_power);
+        mutex_unlock(&priv->lock);
+        return ret;
+
+    default:
+        return -EINVAL;
+    }
+}
+
+static int adxl345_iio_read_avail(struct iio_dev *indio_dev, struct iio_chan_spec const *chan,
+                                  const int **vals, int *type, int *length, long mask)
+{
+    struct adxl345_data *priv = adxl345_iio_priv(indio_dev);
+    int count = 0;
+
+    switch (mask) {
+    case IIO_CHAN_INFO_SCALE:
+        *vals = adxl345_iio_scale_avail;
+        *type = IIO_VAL_INT_PLUS_NANO;
+        *length = ARRAY_SIZE(adxl345_iio_scale_avail);
+        return IIO_AVAIL_LIST;
+
+    case IIO_CHAN_INFO_SAMP_FREQ:
+        // Seuls les débits soutenables par le bus sont proposés
+        while (count < ARRAY_SIZE(adxl345_odr_mhz) && adxl345_odr_mhz[count] <= priv->max_odr_mhz)
+            count++;
+
+        *vals = (const int *)adxl345_iio_odr_avail;
+        *type = IIO_VAL_INT_PLUS_MICRO;
+        *length = count * 2;
+        return IIO_AVAIL_LIST;
+
+    default:
+        return -EINVAL;
+    }
+}
+
+static int adxl345_iio_set_watermark(struct iio_dev *indio_dev, unsigned int val)
+{
+    struct adxl345_data *priv = adxl345_iio_priv(indio_dev);
+    int ret;
+
+    // Le buffer IIO peut demander plus que la FIFO matérielle ne contient
+    val = clamp_t(unsigned int, val, 1, ADXL345_FIFO_SAMPLES);
+
+    mutex_lock(&priv->lock);
+    ret = adxl345_set_watermark(priv, val);
+    mutex_unlock(&priv->lock);
+
+    return ret;
+}
+
+static const struct iio_info adxl345_iio_info = {
+    .read_raw = adxl345_iio_read_raw,
+    .write_raw = adxl345_iio_write_raw,
+    .read_avail = adxl345_iio_read_avail,
+    .hwfifo_set_watermark = adxl345_iio_set_watermark,
+};
+
+static int adxl345_iio_preenable(struct iio_dev *indio_dev)
+{
+    return adxl345_pm_get(adxl345_iio_priv(indio_dev));
+}
+
+static int adxl345_iio_postdisable(struct iio_dev *indio_dev)
+{
+    adxl345_pm_put(adxl345_iio_priv(indio_dev));
+    return 0;
+}
+
+static const struct iio_buffer_setup_ops adxl345_iio_buffer_ops = {
+    .preenable = adxl345_iio_preenable,
+    .postdisable = adxl345_iio_postdisable,
+};
+
+static ssize_t hwfifo_watermark_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = adxl345_iio_priv(dev_to_iio_dev(dev));
+    return fifo_watermark_show(priv->dev, attr, buf);
+}
+
+static ssize_t hwfifo_enabled_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = adxl345_iio_priv(dev_to_iio_dev(dev));
+    bool enabled;
+
+    mutex_lock(&priv->lock);
+    enabled = !priv->data_ready;
+    mutex_unlock(&priv->lock);
+
+    return sprintf(buf, "%d\n", enabled);
+}
+
+static IIO_STATIC_CONST_DEVICE_ATTR(hwfifo_watermark_min, "1");
+static IIO_STATIC_CONST_DEVICE_ATTR(hwfifo_watermark_max, __stringify(ADXL345_FIFO_SAMPLES));
+static IIO_DEVICE_ATTR_RO(hwfifo_watermark, 0);
+static IIO_DEVICE_ATTR_RO(hwfifo_enabled, 0);
+
+static const struct iio_dev_attr *adxl345_iio_fifo_attrs[] = {
+    &iio_dev_attr_hwfifo_watermark_min,
+    &iio_dev_attr_hwfifo_watermark_max,
+    &iio_dev_attr_hwfifo_watermark,
+    &iio_dev_attr_hwfifo_enabled,
+    NULL,
+};
+
+/*
+ * adxl345_iio_setup - Alloue le device IIO et son buffer kfifo
+ *
+ * Le device n'est enregistré qu'à la fin de la probe, une fois le capteur
+ * configuré ; d'ici là iio_buffer_enabled() reste faux.
+ */
+static int adxl345_iio_setup(struct adxl345_data *priv)
+{
+    struct device *dev = priv->dev;
+    struct iio_dev *indio_dev;
+
+    indio_dev = devm_iio_device_alloc(dev, sizeof(priv));
+    if (!indio_dev)
+        return -ENOMEM;
+
+    *(struct adxl345_data **)iio_priv(indio_dev) = priv;
+    indio_dev->name = DRV_NAME;
+    indio_dev->info = &adxl345_iio_info;
+    indio_dev->modes = INDIO_DIRECT_MODE;
+    indio_dev->channels = adxl345_iio_channels;
+    indio_dev->num_channels = ARRAY_SIZE(adxl345_iio_channels);
+    indio_dev->available_scan_masks = adxl345_iio_scan_masks;
+
+    priv->indio_dev = indio_dev;
+
+    return devm_iio_kfifo_buffer_setup_ext(dev, indio_dev, &adxl345_iio_buffer_ops,
+                                           adxl345_iio_fifo_attrs);
+}
+
+/*
+ * adxl345_runtime_suspend - Standby : plus de conversions ni d'interruptions
+ * de données, la configuration des registres est conservée
+ */
+static int adxl345_runtime_suspend(struct device *dev)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int ret;
+
+    mutex_lock(&priv->lock);
+
+    // Les échantillons restés dans la FIFO sont publiés avant l'arrêt
+    if (!priv->data_ready)
+        adxl345_fifo_drain(priv, 0);
+
+    ret = adxl345_write_reg(priv, ADXL345_POWER_CTL, ADXL345_SLEEP_MODE);
+    if (ret == 0) {
+        priv->suspend_count++;
+        priv->suspend_start = ktime_get_ns();
+    }
+
+    mutex_unlock(&priv->lock);
+    return ret;
+}
+
+static int adxl345_runtime_resume(struct device *dev)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    int ret;
+
+    mutex_lock(&priv->lock);
+
+    ret = adxl345_write_reg(priv, ADXL345_POWER_CTL, ADXL345_MEASURE_MODE);
+    if (ret == 0) {
+        priv->resume_count++;
+        if (priv->suspend_start)
+            priv->suspended_ns += ktime_get_ns() - priv->suspend_start;
+        priv->suspend_start = 0;
+    }
+
+    mutex_unlock(&priv->lock);
+    return ret;
+}
+
+DEFINE_RUNTIME_DEV_PM_OPS(adxl345_pm_ops, adxl345_runtime_suspend,
+                                 adxl345_runtime_resume, NULL);
+
+/*
+ * adxl345_data_release - Libère priv à la dernière référence
+ *
+ * Appelée au remove, ou plus tard à la fermeture du dernier descripteur
+ * resté ouvert (et donc après le dernier munmap() de l'anneau).
+ */
+static void adxl345_data_release(struct kref *kref)
+{
+    struct adxl345_data *priv = container_of(kref, struct adxl345_data, kref);
+
+    vfree(priv->ring);
+    mutex_destroy(&priv->events_pm_lock);
+    mutex_destroy(&priv->read_lock);
+    mutex_destroy(&priv->lock);
+    put_device(priv->dev);
+    kfree(priv);
+}
+
+static void adxl345_free_index(void *data)
+{
+    struct adxl345_data *priv = data;
+
+    ida_free(&adxl345_ida, priv->index);
+}
+
+/*
+ * bus_stats - Synthèse des compteurs bus, taux d'erreur en ppm
+ */
+static int adxl345_bus_stats_show(struct seq_file *s, void *unused)
+{
+    struct adxl345_data *priv = s->private;
+    u64 reads, writes, errors;
+
+    mutex_lock(&priv->lock);
+    reads = priv->bus_reads;
+    writes = priv->bus_writes;
+    errors = priv->bus_errors;
+    mutex_unlock(&priv->lock);
+
+    seq_printf(s, "transactions: %llu (%llu reads, %llu writes)\n", reads + writes, reads, writes);
+    seq_printf(s, "errors: %llu (%llu ppm)\n", errors,
+               reads + writes ? div64_u64(errors * 1000000, reads + writes) : 0);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(adxl345_bus_stats);
+
+/*
+ * adxl345_debugfs_init - Compteurs sous /sys/kernel/debug/adxl345/<nom>/
+ *
+ * Les erreurs de debugfs ne sont pas fatales, les appels suivants
+ * acceptent un répertoire invalide.
+ */
+static void adxl345_debugfs_init(struct adxl345_data *priv)
+{
+    priv->debugfs = debugfs_create_dir(priv->name, adxl345_debugfs_root);
+
+    debugfs_create_u64("bus_reads", 0444, priv->debugfs, &priv->bus_reads);
+    debugfs_create_u64("bus_writes", 0444, priv->debugfs, &priv->bus_writes);
+    debugfs_create_u64("bus_read_bytes", 0444, priv->debugfs, &priv->bus_read_bytes);
+    debugfs_create_u64("bus_write_bytes", 0444, priv->debugfs, &priv->bus_write_bytes);
+    debugfs_create_u64("bus_errors", 0444, priv->debugfs, &priv->bus_errors);
+    debugfs_create_file("bus_stats", 0444, priv->debugfs, priv, &adxl345_bus_stats_fops);
+}
+
+static void adxl345_debugfs_remove(void *data)
+{
+    struct adxl345_data *priv = data;
+
+    debugfs_remove_recursive(priv->debugfs);
+}
+
+
+/*
+ * adxl345_prop_lsb - Propriété en unités physiques vers cfg[reg]
+ * La valeur déjà dans cfg est conservée si la propriété est absente.
+ */
+static int adxl345_prop_lsb(struct adxl345_data *priv, const char *prop, u8 *cfg,
+                            u8 reg, u32 unit, u32 div)
+{
+    u32 val;
+    int lsb;
+
+    if (device_property_read_u32(priv->dev, prop, &val))
+        return 0;
+
+    lsb = adxl345_to_lsb(val, unit, div);
+    if (lsb < 0) {
+        dev_err(priv->dev, "%s hors limites: %u\n", prop, val);
+        return lsb;
+    }
+
+    cfg[reg] = lsb;
+    return 0;
+}
+
+// Propriété chaîne "xyz" vers bits ADXL345_TAP_AXIS_*, inchangés si absente
+static int adxl345_prop_axes(struct adxl345_data *priv, const char *prop, u8 *axes)
+{
+    const char *str;
+    int ret;
+
+    if (device_property_read_string(priv->dev, prop, &str))
+        return 0;
+
+    ret = adxl345_parse_axes(str, strlen(str));
+    if (ret < 0) {
+        dev_err(priv->dev, "%s invalide: %s\n", prop, str);
+        return ret;
+    }
+
+    *axes = ret;
+    return 0;
+}
+
+/*
+ * adxl345_read_profile - Configuration initiale depuis le device tree
+ * @cfg: image des registres indexée par adresse, remplie pour 0x1D..0x31
+ *
+ * Propriétés optionnelles, unités comme dans sysfs :
+ *   adi,tap-threshold-mg, adi,tap-duration-us, adi,tap-latency-us,
+ *   adi,tap-window-us, adi,tap-axes ("xyz"),
+ *   adi,activity-threshold-mg, adi,inactivity-threshold-mg,
+ *   adi,inactivity-time-s, adi,act-inact-axes, adi,act-inact-ac-coupled,
+ *   adi,freefall-threshold-mg, adi,freefall-time-ms,
+ *   adi,range-g, adi,full-resolution, adi,odr-mhz, adi,low-power,
+ *   adi,int-map (sources INT_MAP routées sur INT2, sans interruption "INT2"),
+ *   adi,offsets (3 cellules signées, LSB de 15.6 mg : calibration sauvegardée)
+ */
+static int adxl345_read_profile(struct adxl345_data *priv, u8 *cfg)
+{
+    struct device *dev = priv->dev;
+    u32 range_g = ADXL345_DEFAULT_RANGE_G;
+    u32 odr_mhz = ADXL345_DEFAULT_ODR_MHZ;
+    u8 tap_axes = ADXL345_TAP_AXES_MASK;
+    u8 act_axes = 0;
+    u32 int_map = 0;
+    s32 ofs[ADXL345_OFS_LEN];
+    bool low_power;
+    u8 odr_code;
+    int range;
+    int ret;
+    int i;
+
+    cfg[ADXL345_THRESH_TAP] = ADXL345_DEFAULT_THRESH_TAP;
+    cfg[ADXL345_DUR] = ADXL345_DEFAULT_DUR;
+    cfg[ADXL345_LATENT] = ADXL345_DEFAULT_LATENT;
+    cfg[ADXL345_WINDOW] = ADXL345_DEFAULT_WINDOW;
+
+    ret = adxl345_prop_lsb(priv, "adi,tap-threshold-mg", cfg, ADXL345_THRESH_TAP,
+                           ADXL345_THRESH_UG_PER_LSB, 1000);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,tap-duration-us", cfg, ADXL345_DUR,
+                                  ADXL345_DUR_US_PER_LSB, 1);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,tap-latency-us", cfg, ADXL345_LATENT,
+                                  ADXL345_LATENT_US_PER_LSB, 1);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,tap-window-us", cfg, ADXL345_WINDOW,
+                                  ADXL345_LATENT_US_PER_LSB, 1);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,activity-threshold-mg", cfg, ADXL345_THRESH_ACT,
+                                  ADXL345_THRESH_UG_PER_LSB, 1000);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,inactivity-threshold-mg", cfg, ADXL345_THRESH_INACT,
+                                  ADXL345_THRESH_UG_PER_LSB, 1000);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,inactivity-time-s", cfg, ADXL345_TIME_INACT, 1, 1);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,freefall-threshold-mg", cfg, ADXL345_THRESH_FF,
+                                  ADXL345_THRESH_UG_PER_LSB, 1000);
+    ret = ret ?: adxl345_prop_lsb(priv, "adi,freefall-time-ms", cfg, ADXL345_TIME_FF,
+                                  ADXL345_TIME_FF_MS_PER_LSB, 1);
+    ret = ret ?: adxl345_prop_axes(priv, "adi,tap-axes", &tap_axes);
+    ret = ret ?: adxl345_prop_axes(priv, "adi,act-inact-axes", &act_axes);
+    if (ret)
+        return ret;
+
+    // Offsets issus d'une calibration précédente, restaurés tels quels
+    if (!device_property_read_u32_array(dev, "adi,offsets", (u32 *)ofs, ADXL345_OFS_LEN)) {
+        for (i = 0; i < ADXL345_OFS_LEN; i++) {
+            if (ofs[i] < S8_MIN || ofs[i] > S8_MAX) {
+                dev_err(dev, "adi,offsets hors limites: %d\n", ofs[i]);
+                return -ERANGE;
+            }
+            cfg[ADXL345_OFSX + i] = (u8)ofs[i];
+        }
+    }
+
+    // Supress bit : un seul axe considéré (recommandation fabricant)
+    cfg[ADXL345_TAP_AXES] = ADXL345_SUPRESS_BIT | tap_axes;
+
+    cfg[ADXL345_ACT_INACT_CTL] = act_axes | (act_axes << ADXL345_ACT_SHIFT);
+    if (device_property_read_bool(dev, "adi,act-inact-ac-coupled"))
+        cfg[ADXL345_ACT_INACT_CTL] |= ADXL345_ACT_INACT_AC | (ADXL345_ACT_INACT_AC << ADXL345_ACT_SHIFT);
+
+    device_property_read_u32(dev, "adi,range-g", &range_g);
+    range = adxl345_g_to_range(range_g);
+    if (range < 0) {
+        dev_err(dev, "adi,range-g invalide: %u\n", range_g);
+        return range;
+    }
+    cfg[ADXL345_DATA_FORMAT] = range;
+    if (device_property_read_bool(dev, "adi,full-resolution"))
+        cfg[ADXL345_DATA_FORMAT] |= ADXL345_FULL_RES;
+
+    // Débit ramené au max du bus si nécessaire
+    device_property_read_u32(dev, "adi,odr-mhz", &odr_mhz);
+    odr_code = adxl345_odr_to_code(odr_mhz);
+    while (adxl345_odr_mhz[odr_code] > priv->max_odr_mhz && odr_code > 0)
+        odr_code--;
+
+    low_power = device_property_read_bool(dev, "adi,low-power");
+    if (low_power && (odr_code < ADXL345_RATE_12_5HZ || odr_code > ADXL345_RATE_400HZ)) {
+        dev_err(dev, "adi,low-power impossible à %u mHz\n", adxl345_odr_mhz[odr_code]);
+        return -EINVAL;
+    }
+    cfg[ADXL345_BW_RATE] = odr_code | (low_power ? ADXL345_BW_LOW_POWER : 0);
+
+    // Avec INT2 câblée : données sur INT2, événements sur INT1 (adi,int-map
+    // ignoré). Sinon seul INT1 a un handler : les sources routées sur INT2
+    // ne remontent que si la carte relie INT2 à la même ligne.
+    if (priv->irq_data)
+        int_map = ADXL345_INT_DATA_MASK;
+    else
+        device_property_read_u32(dev, "adi,int-map", &int_map);
+    cfg[ADXL345_INT_MAP] = int_map;
+
+    return 0;
+}
+
+/*
+ * adxl345_apply_profile - Programme le profil en deux écritures groupées
+ *
+ * 0x1D..0x2A (tap, offsets, activité, chute libre) puis 0x2C..0x31 (débit,
+ * alimentation, interruptions, format), capteur en standby et interruptions
+ * masquées. INT_SOURCE (0x30) est en lecture seule : l'octet écrit est
+ * ignoré. La mesure démarre une fois la FIFO configurée.
+ */
+static int adxl345_apply_profile(struct adxl345_data *priv, u8 *cfg)
+{
+    int ret;
+
+    cfg[ADXL345_POWER_CTL] = ADXL345_SLEEP_MODE;
+    cfg[ADXL345_INT_ENABLE] = 0;
+    cfg[ADXL345_INT_SOURCE] = 0;
+
+    ret = adxl345_write_regs(priv, ADXL345_THRESH_TAP, ADXL345_PROFILE_EVT_LEN,
+                             &cfg[ADXL345_THRESH_TAP]);
+    if (ret < 0)
+        return ret;
+
+    ret = adxl345_write_regs(priv, ADXL345_BW_RATE, ADXL345_PROFILE_CTL_LEN,
+                             &cfg[ADXL345_BW_RATE]);
+    if (ret < 0)
+        return ret;
+
+    priv->range = cfg[ADXL345_DATA_FORMAT] & ADXL345_RANGE_MASK;
+    priv->full_res = cfg[ADXL345_DATA_FORMAT] & ADXL345_FULL_RES;
+    priv->scale_idx = priv->full_res ? 0 : priv->range;
+    priv->odr_code = cfg[ADXL345_BW_RATE] & ADXL345_BW_RATE_MASK;
+    priv->low_power = cfg[ADXL345_BW_RATE] & ADXL345_BW_LOW_POWER;
+    priv->sample_period_ns = div_u64((u64)NSEC_PER_SEC * 1000, adxl345_odr_mhz[priv->odr_code]);
+
+    ret = adxl345_write_fifo_ctl(priv);
+    if (ret < 0)
+        return ret;
+
+    return adxl345_write_reg(priv, ADXL345_POWER_CTL, ADXL345_MEASURE_MODE);
+}
+
+/*
+ * adxl345_core_probe - Initialisation commune, appelée par le front-end du bus
+ * @dev: device du client I2C ou SPI
+ * @irq: ligne INT1
+ * @bus: accès registres du bus
+ * @max_odr_mhz: débit soutenable par le bus, en mHz
+ */
+int adxl345_core_probe(struct device *dev, int irq, const struct adxl345_bus_ops *bus, u32 max_odr_mhz)
+{
+    u8 cfg[ADXL345_REG_COUNT] = { 0 };
+    struct adxl345_data *priv;
+    u32 irq_int2;
+    u8 motion;
+    u8 devid;
+    int ret;
+
+    // Vérification DEVID
+    ret = bus->read_regs(dev, ADXL345_DEVID, 1, &devid);
+    if (ret < 0)
+        return ret;
+    if (devid != ADXL345_DEVID_VAL) {
+        dev_err(dev, "ID invalide: 0x%02x (attendu: 0x%02x)\n", 
+                devid, ADXL345_DEVID_VAL);
+        return -ENODEV;
+    }
+
+    // Allocation structure driver, hors devm : les descripteurs encore
+    // ouverts au remove la gardent (kref), le device avec elle
+    priv = kzalloc(sizeof(*priv), GFP_KERNEL);
+    if (!priv)
+        return -ENOMEM;
+
+    kref_init(&priv->kref);
+    priv->dev = get_device(dev);
+    priv->bus = bus;
+    mutex_init(&priv->lock);
+    mutex_init(&priv->read_lock);
+    mutex_init(&priv->events_pm_lock);
+    init_completion(&priv->calib_done);
+    init_waitqueue_head(&priv->read_queue);
+    INIT_LIST_HEAD(&priv->readers);
+    atomic_set(&priv->fifo_dropped, 0);
+    priv->fifo_watermark = ADXL345_FIFO_WATERMARK_DEFAULT;
+    priv->default_mode = ADXL345_MODE_TEXT;
+    dev_set_drvdata(dev, priv);
+
+    // Référence du probe, rendue en dernier par devm (après le remove)
+    ret = devm_add_action_or_reset(dev, adxl345_put_data, priv);
+    if (ret)
+        return ret;
+
+    // Numéro d'instance : le premier capteur garde les noms historiques
+    // (/dev/adxl345, /dev/adxl345_events), les suivants sont indexés
+    ret = ida_alloc(&adxl345_ida, GFP_KERNEL);
+    if (ret < 0)
+        return ret;
+    priv->index = ret;
+
+    ret = devm_add_action_or_reset(dev, adxl345_free_index, priv);
+    if (ret)
+        return ret;
+
+    if (priv->index == 0) {
+        strscpy(priv->name, DRV_NAME, sizeof(priv->name));
+        strscpy(priv->event_name, EVT_NAME, sizeof(priv->event_name));
+    } else {
+        snprintf(priv->name, sizeof(priv->name), DRV_NAME "-%d", priv->index);
+        snprintf(priv->event_name, sizeof(priv->event_name), EVT_NAME "-%d", priv->index);
+    }
+
+    adxl345_debugfs_init(priv);
+    ret = devm_add_action_or_reset(dev, adxl345_debugfs_remove, priv);
+    if (ret)
+        return ret;
+
+    // Débit max selon la fréquence du bus, calculé par le front-end
+    priv->max_odr_mhz = max_odr_mhz;
+
+    // Capture autour des événements, désactivée tant que capture_pre et
+    // capture_post valent 0
+    priv->capture_hist = devm_kcalloc(dev, ADXL345_CAPTURE_MAX, sizeof(*priv->capture_hist), GFP_KERNEL);
+    priv->capture = devm_kzalloc(dev, ADXL345_CAPTURE_BYTES, GFP_KERNEL);
+    if (!priv->capture_hist || !priv->capture)
+        return -ENOMEM;
+
+    // INT2 optionnelle (interrupt-names = "INT1", "INT2") : les sources de
+    // données y sont routées et ont leur propre thread. Un software node ne
+    // décrit pas d'interruption : adxl345_emul donne le numéro Linux de sa
+    // ligne INT2 dans linux,int2-irq.
+    ret = fwnode_irq_get_byname(dev_fwnode(dev), "INT2");
+    if (ret == -EPROBE_DEFER)
+        return ret;
+    if (ret <= 0 && !device_property_read_u32(dev, "linux,int2-irq", &irq_int2))
+        ret = irq_int2;
+    priv->irq_data = ret > 0 ? ret : 0;
+
+    // Profil de configuration : device tree, valeurs historiques sinon
+    ret = adxl345_read_profile(priv, cfg);
+    if (ret)
+        return ret;
+
+    // Deux écritures groupées puis FIFO en mode stream : le capteur accumule
+    // jusqu'à 32 échantillons et signale le watermark
+    ret = adxl345_apply_profile(priv, cfg);
+    if (ret < 0) {
+        dev_err(dev, "Erreur application du profil de configuration\n");
+        goto err_power_off;
+    }
+
+    // Stocker le numéro d'IRQ
+    priv->irq = irq;
+
+    // Initialisation sysfs
+    priv->tap_axis = 'z';  // Valeur par défaut
+    priv->tap_mode = 'o';  // Mode off par défaut
+    atomic_set(&priv->tap_count, 0);
+    init_waitqueue_head(&priv->wait_queue);
+    INIT_LIST_HEAD(&priv->subscribers);
+    spin_lock_init(&priv->event_lock);
+
+    // Front-end IIO, enregistré en fin de probe
+    ret = adxl345_iio_setup(priv);
+    if (ret) {
+        dev_err(dev, "Erreur allocation device IIO\n");
+        goto err_power_off;
+    }
+
+    // Enregistrer l'IRQ : handler primaire pour l'horodatage, thread pour le bus
+    ret = devm_request_threaded_irq(dev, priv->irq, adxl345_irq_handler, adxl345_irq_thread, 
+        IRQF_TRIGGER_RISING | IRQF_ONESHOT, DRV_NAME, priv);
+
+    if (ret) {
+        dev_err(dev, "Erreur demande IRQ %d\n", priv->irq);
+        goto err_power_off;
+    }
+
+    if (priv->irq_data) {
+        ret = devm_request_threaded_irq(dev, priv->irq_data, adxl345_irq_data_handler,
+            adxl345_irq_data_thread, IRQF_TRIGGER_RISING | IRQF_ONESHOT, DRV_NAME "-int2", priv);
+        if (ret) {
+            dev_err(dev, "Erreur demande IRQ %d (INT2)\n", priv->irq_data);
+            goto err_power_off;
+        }
+    }
+
+    // Activation des interruptions une fois le handler en place : l'IRQ est
+    // sur front, un watermark déjà atteint avant serait perdu
+    // Taps désactivés comme tap_mode ('o') : le capteur peut passer en
+    // standby. Détections de mouvement armées si le profil leur donne un seuil
+    motion = (cfg[ADXL345_THRESH_ACT] ? ADXL345_INT_ACTIVITY : 0) |
+             (cfg[ADXL345_THRESH_INACT] ? ADXL345_INT_INACTIVITY : 0) |
+             (cfg[ADXL345_THRESH_FF] ? ADXL345_INT_FREE_FALL : 0);
+    priv->int_enable = ADXL345_INT_FIFO_MASK;
+    mutex_lock(&priv->lock);
+    ret = adxl345_write_int_enable(priv, ADXL345_INT_TAP_MASK | ADXL345_INT_MOTION_MASK,
+                                   motion);
+    mutex_unlock(&priv->lock);
+    if (ret < 0) {
+        dev_err(dev, "Erreur configuration interruptions\n");
+        goto err_power_off;
+    }
+
+    // Runtime PM : le capteur est en mesure, il passera en standby après
+    // ADXL345_AUTOSUSPEND_MS sans utilisateur. La référence prise ici est
+    // rendue en fin de probe.
+    pm_runtime_set_active(dev);
+    pm_runtime_set_autosuspend_delay(dev, ADXL345_AUTOSUSPEND_MS);
+    pm_runtime_use_autosuspend(dev);
+    pm_runtime_get_noresume(dev);
+    pm_runtime_enable(dev);
+
+    // Mouvements armés par le profil : le capteur doit rester en mesure
+    ret = adxl345_update_events_pm(priv);
+    if (ret)
+        goto err_pm_disable;
+
+    // Enregistrement sysfs
+    ret = sysfs_create_group(&dev->kobj, &adxl345_attr_group);
+    if (ret) {
+        dev_err(dev, "Erreur création sysfs\n");
+        goto err_pm_disable;
+    }
+
+    // Configuration miscdevice
+    priv->miscdev.minor = MISC_DYNAMIC_MINOR;
+    priv->miscdev.name = priv->name;
+    priv->miscdev.fops = &adxl345_fops;
+    priv->miscdev.parent = dev;
+
+    ret = misc_register(&priv->miscdev);
+    if (ret) {
+        dev_err(dev, "Erreur enregistrement miscdevice\n");
+        // Mise en veille en cas d'erreur
+        adxl345_write_reg(priv, ADXL345_POWER_CTL, ADXL345_SLEEP_MODE);
+
+        goto err_misc_register;
+    }
+
+    // Interface événements : une file par descripteur ouvert
+    priv->event_miscdev.minor = MISC_DYNAMIC_MINOR;
+    priv->event_miscdev.name = priv->event_name;
+    priv->event_miscdev.fops = &adxl345_event_fops;
+    priv->event_miscdev.parent = dev;
+
+    ret = misc_register(&priv->event_miscdev);
+    if (ret) {
+        dev_err(dev, "Erreur enregistrement miscdevice événements\n");
+        goto err_event_register;
+    }
+
+    ret = iio_device_register(priv->indio_dev);
+    if (ret) {
+        dev_err(dev, "Erreur enregistrement device IIO\n");
+        goto err_iio_register;
+    }
+
+    // Visible par la capture groupée
+    mutex_lock(&adxl345_group_lock);
+    list_add_tail(&priv->node, &adxl345_instances);
+    mutex_unlock(&adxl345_group_lock);
+
+    pm_runtime_mark_last_busy(dev);
+    pm_runtime_put_autosuspend(dev);
+
+    dev_info(dev, "Driver ADXL345 init (/dev/%s)\n", priv->name);
+    return 0;    
+
+err_iio_register:
+    misc_deregister(&priv->event_miscdev);
+err_event_register:
+    misc_deregister(&priv->miscdev);
+err_misc_register:
+    sysfs_remove_group(&dev->kobj, &adxl345_attr_group);
+err_pm_disable:
+    // Référence des détections armées prise par adxl345_update_events_pm()
+    if (priv->events_pm_ref) {
+        pm_runtime_put_noidle(dev);
+        priv->events_pm_ref = false;
+    }
+    pm_runtime_disable(dev);
+    pm_runtime_set_suspended(dev);
+    pm_runtime_put_noidle(dev);
+    pm_runtime_dont_use_autosuspend(dev);
+err_power_off:
+    adxl345_write_reg(priv, ADXL345_POWER_CTL, ADXL345_SLEEP_MODE);
+    return ret;
+}
+
+void adxl345_core_remove(struct device *dev)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    struct adxl345_file *file_data;
+
+    // Retrait de la capture groupée avant tout le reste
+    mutex_lock(&adxl345_group_lock);
+    list_del(&priv->node);
+    if (priv->group_member)
+        adxl345_group_detach(priv->group_member);
+    mutex_unlock(&adxl345_group_lock);
+
+    iio_device_unregister(priv->indio_dev);
+
+    // Plus de nouveaux descripteurs. Ceux déjà ouverts gardent priv (kref)
+    // et obtiennent -ENODEV une fois dead positionné.
+    misc_deregister(&priv->event_miscdev);
+    misc_deregister(&priv->miscdev);
+
+    // Plus de suspend/resume concurrents : le capteur est coupé ci-dessous
+    mutex_lock(&priv->events_pm_lock);
+    if (priv->events_pm_ref) {
+        pm_runtime_put_noidle(dev);
+        priv->events_pm_ref = false;
+    }
+    mutex_unlock(&priv->events_pm_lock);
+    pm_runtime_disable(dev);
+    pm_runtime_set_suspended(dev);
+    pm_runtime_dont_use_autosuspend(dev);
+
+    // Désactiver les interruptions et la FIFO
+    mutex_lock(&priv->lock);
+    adxl345_write_reg(priv, ADXL345_INT_ENABLE, 0);
+    adxl345_write_reg(priv, ADXL345_FIFO_CTL, ADXL345_FIFO_BYPASS);
+    // Mise en veille du capteur
+    adxl345_write_reg(priv, ADXL345_POWER_CTL, ADXL345_SLEEP_MODE);
+    priv->dead = true;
+    list_for_each_entry(file_data, &priv->readers, reader_node)
+        wake_up_interruptible(&file_data->wait);
+    mutex_unlock(&priv->lock);
+
+    // Réveil des lecteurs, de tap_wait et d'une calibration en cours :
+    // sysfs_remove_group() attend la fin des attributs en cours
+    wake_up_interruptible(&priv->read_queue);
+    wake_up_interruptible(&priv->wait_queue);
+    complete(&priv->calib_done);
+
+    // Nettoyage des ressources, priv est libérée par devm ou au dernier close
+    sysfs_remove_group(&dev->kobj, &adxl345_attr_group);
+    dev_info(dev, "Driver ADXL345 removed\n");
+}
+
+const struct of_device_id adxl345_of_match[] = {
+    { .compatible = "adi,adxl345" },
+    { }
+};
+MODULE_DEVICE_TABLE(of, adxl345_of_match);
+
+static int __init adxl345_init(void)
+{
+    int ret;
+
+    adxl345_debugfs_root = debugfs_create_dir(DRV_NAME, NULL);
+
+    // Le nœud du groupe existe même sans capteur : open() retourne -ENODEV
+    ret = misc_register(&adxl345_group_miscdev);
+    if (ret) {
+        pr_err("Erreur enregistrement miscdevice groupe\n");
+        debugfs_remove_recursive(adxl345_debugfs_root);
+        return ret;
+    }
+
+    ret = adxl345_i2c_register();
+    if (ret)
+        goto err_i2c;
+
+    ret = adxl345_spi_register();
+    if (ret)
+        goto err_spi;
+
+    return 0;
+
+err_spi:
+    adxl345_i2c_unregister();
+err_i2c:
+    misc_deregister(&adxl345_group_miscdev);
+    debugfs_remove_recursive(adxl345_debugfs_root);
+    return ret;
+}
+
+static void __exit adxl345_exit(void)
+{
+    adxl345_spi_unregister();
+    adxl345_i2c_unregister();
+    misc_deregister(&adxl345_group_miscdev);
+    debugfs_remove_recursive(adxl345_debugfs_root);
+    ida_destroy(&adxl345_ida);
+}
+
+module_init(adxl345_init);
+module_exit(adxl345_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Thomas Stäheli");
+MODULE_DESCRIPTION("Driver ADXL345 pour mesures d'accélération");
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef ADXL345_CORE_H
+#define ADXL345_CORE_H
+
+#include <linux/device.h>
+#include <linux/mod_devicetable.h>
+#include <linux/pm.h>
+#include <linux/types.h>
+
+/*
+ * Accès registres fournis par le front-end du bus (I2C ou SPI).
+ * Retournent 0 ou un code d'erreur négatif. read_regs et write_regs
+ * accèdent à len registres consécutifs (32 max) en une seule transaction.
+ */
+struct adxl345_bus_ops {
+    int (*read_regs)(struct device *dev, u8 reg, u8 len, u8 *buf);
+    int (*write_reg)(struct device *dev, u8 reg, u8 val);
+    int (*write_regs)(struct device *dev, u8 reg, u8 len, const u8 *buf);
+};
+
+int adxl345_core_probe(struct device *dev, int irq, const struct adxl345_bus_ops *bus, u32 max_odr_mhz);
+void adxl345_core_remove(struct device *dev);
+
+extern const struct dev_pm_ops adxl345_pm_ops;
+extern const struct of_device_id adxl345_of_match[];
+
+// Enregistrement des drivers de bus, appelé par l'init du module
+int adxl345_i2c_register(void);
+void adxl345_i2c_unregister(void);
+int adxl345_spi_register(void);
+void adxl345_spi_unregister(void);
+
+#endif /* ADXL345_CORE_H */
@@ -0,0 +1,1074 @@
+/*
+ * Author : Thomas Stäheli
+ *
+ * ADXL345 émulé, pour tester et mesurer le driver sans la carte (x86 compris) :
+ *
+ *   insmod adxl345_emul.ko [bus=i2c|spi] [speedup=N] [int2=1] && insmod adxl345.ko
+ *
+ * Le capteur est exposé derrière un adaptateur I2C virtuel (adresse 0x53,
+ * même nom que sur la DE1-SoC) ou un contrôleur SPI logiciel. Le modèle
+ * couvre la carte des registres, la FIFO (bypass, FIFO, stream, trigger),
+ * les offsets, la détection tap/double tap, activité/inactivité et chute
+ * libre, et les interruptions sur deux lignes INT1 et INT2 simulées (irq_sim),
+ * chaque source étant routée selon INT_MAP. Avec int2=1, la ligne INT2 est
+ * aussi donnée au driver, qui y route DATA_READY et le watermark.
+ *
+ * Les échantillons suivent l'ODR programmée (divisée par speedup pour les
+ * mesures de débit) et une forme d'onde choisie dans sysfs :
+ *   /sys/devices/platform/adxl345_emul/{waveform,amplitude_mg,frequency_mhz,tap,...}
+*/
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/property.h>
+#include <linux/i2c.h>
+#include <linux/spi/spi.h>
+#include <linux/irq.h>
+#include <linux/irq_sim.h>
+#include <linux/interrupt.h>
+#include <linux/hrtimer.h>
+#include <linux/spinlock.h>
+#include <linux/random.h>
+#include <linux/fixp-arith.h>
+#include <linux/math64.h>
+
+#define DRV_NAME "adxl345_emul"
+
+// Registres modélisés
+#define EMUL_DEVID              0x00
+#define EMUL_DEVID_VAL          0xE5
+#define EMUL_THRESH_TAP         0x1D
+#define EMUL_OFSX               0x1E
+#define EMUL_DUR                0x21
+#define EMUL_LATENT             0x22
+#define EMUL_WINDOW             0x23
+#define EMUL_THRESH_ACT         0x24
+#define EMUL_THRESH_INACT       0x25
+#define EMUL_TIME_INACT         0x26
+#define EMUL_ACT_INACT_CTL      0x27
+#define EMUL_THRESH_FF          0x28
+#define EMUL_TIME_FF            0x29
+#define EMUL_TAP_AXES           0x2A
+#define EMUL_ACT_TAP_STATUS     0x2B
+#define EMUL_BW_RATE            0x2C
+#define EMUL_POWER_CTL          0x2D
+#define EMUL_INT_ENABLE         0x2E
+#define EMUL_INT_MAP            0x2F
+#define EMUL_INT_SOURCE         0x30
+#define EMUL_DATA_FORMAT        0x31
+#define EMUL_DATAX0             0x32
+#define EMUL_DATAZ1             0x37
+#define EMUL_FIFO_CTL           0x38
+#define EMUL_FIFO_STATUS        0x39
+#define EMUL_REG_COUNT          0x40
+
+#define EMUL_I2C_ADDR           0x53
+// Fréquence annoncée pour le bus I2C virtuel : le driver en déduit l'ODR max
+#define EMUL_I2C_HZ             3400000
+
+#define EMUL_SPI_READ           (1 << 7)
+#define EMUL_SPI_MB             (1 << 6)
+#define EMUL_SPI_ADDR_MASK      0x3F
+#define EMUL_SPI_HZ             5000000
+
+#define EMUL_MEASURE            0x08
+#define EMUL_RATE_MASK          0x0F
+#define EMUL_RATE_100HZ         0x0A
+#define EMUL_RANGE_MASK         0x03
+#define EMUL_FULL_RES           (1 << 3)
+
+// FIFO_CTL / FIFO_STATUS
+#define EMUL_FIFO_MODE_MASK     0xC0
+#define EMUL_FIFO_BYPASS        (0 << 6)
+#define EMUL_FIFO_FIFO          (1 << 6)
+#define EMUL_FIFO_STREAM        (2 << 6)
+#define EMUL_FIFO_TRIGGER       (3 << 6)
+#define EMUL_FIFO_TRIG_INT2     (1 << 5)
+#define EMUL_FIFO_SAMPLES       0x1F
+#define EMUL_FIFO_TRIG          (1 << 7)
+#define EMUL_FIFO_DEPTH         32
+
+// INT_ENABLE / INT_MAP / INT_SOURCE
+#define EMUL_INT_DATA_READY     0x80
+#define EMUL_INT_SINGLE_TAP     0x40
+#define EMUL_INT_DOUBLE_TAP     0x20
+#define EMUL_INT_ACTIVITY       0x10
+#define EMUL_INT_INACTIVITY     0x08
+#define EMUL_INT_FREE_FALL      0x04
+#define EMUL_INT_WATERMARK      0x02
+#define EMUL_INT_OVERRUN        0x01
+
+// Lignes d'interruption simulées (hwirq du domaine irq_sim)
+#define EMUL_INT1               0
+#define EMUL_INT2               1
+#define EMUL_INT_LINES          2
+
+// Unités des registres de détection (datasheet)
+#define EMUL_THRESH_UG          62500   // THRESH_TAP/ACT/INACT/FF
+#define EMUL_DUR_NS             625000
+#define EMUL_LATENT_NS          1250000
+#define EMUL_FF_NS              5000000
+#define EMUL_OFS_UG             15600
+#define EMUL_LSB_UG             3900    // Pleine résolution ou +-2g 10 bits
+
+// Amplitude d'un tap injecté par sysfs
+#define EMUL_TAP_MG             4000
+#define EMUL_ONE_G_MG           1000
+
+enum emul_waveform {
+    EMUL_WAVE_STILL,        // 1 g sur Z
+    EMUL_WAVE_SINE,         // Sinus sur X
+    EMUL_WAVE_SQUARE,       // Carré sur X
+    EMUL_WAVE_NOISE,        // Bruit uniforme sur les trois axes
+    EMUL_WAVE_TAPS,         // Impulsion sur Z à chaque période
+    EMUL_WAVE_FREEFALL,     // 0 g sur les trois axes pendant 30% de la période
+};
+
+static const char * const emul_waveform_names[] = {
+    [EMUL_WAVE_STILL]    = "still",
+    [EMUL_WAVE_SINE]     = "sine",
+    [EMUL_WAVE_SQUARE]   = "square",
+    [EMUL_WAVE_NOISE]    = "noise",
+    [EMUL_WAVE_TAPS]     = "taps",
+    [EMUL_WAVE_FREEFALL] = "freefall",
+};
+
+static char *bus = "i2c";
+module_param(bus, charp, 0444);
+MODULE_PARM_DESC(bus, "Bus du capteur émulé : i2c ou spi");
+
+static unsigned int speedup = 1;
+module_param(speedup, uint, 0444);
+MODULE_PARM_DESC(speedup, "Facteur d'accélération du temps simulé (1..64)");
+
+static bool int2;
+module_param(int2, bool, 0444);
+MODULE_PARM_DESC(int2, "Relie aussi INT2 au driver (flux de données sur INT2)");
+
+struct adxl345_emul {
+    struct platform_device *pdev;
+    struct i2c_adapter adapter;
+    struct i2c_client *client;
+    struct spi_controller *ctlr;
+    struct irq_domain *irq_domain;
+    int irq[EMUL_INT_LINES];
+    // Software node du capteur avec int2=1 : numéro de la ligne INT2
+    struct property_entry client_props[2];
+    struct software_node client_node;
+    struct hrtimer timer;
+    spinlock_t lock;                // Protège tout ce qui suit
+
+    u8 regs[EMUL_REG_COUNT];
+    s16 fifo[EMUL_FIFO_DEPTH][3];
+    s16 last[3];                    // Dernier échantillon dépilé (bypass)
+    unsigned int fifo_head;
+    unsigned int fifo_count;
+    bool fresh;                     // Bypass : échantillon pas encore lu
+    bool overrun;
+    bool triggered;                 // Mode trigger : événement reçu
+    u8 latched;                     // Sources tap/activité, effacées à la lecture
+    bool irq_level[EMUL_INT_LINES]; // État des lignes INT1 et INT2
+
+    // Temps simulé et détection
+    u64 now_ns;
+    u64 tap_start_ns;
+    u64 first_tap_ns;
+    u8 tap_axes;
+    bool tap_above;
+    s32 ref_mg[3];                  // Référence du couplage AC
+    u64 inact_start_ns;
+    bool inact_fired;
+    u64 ff_start_ns;
+    bool ff_active;
+    bool ff_fired;
+
+    // Forme d'onde
+    enum emul_waveform waveform;
+    u32 amplitude_mg;
+    u32 frequency_mhz;
+    u64 last_cycle;
+    unsigned int inject_taps;
+
+    // Statistiques
+    u64 samples;
+    u64 irqs[EMUL_INT_LINES];
+    u64 transfers;
+};
+
+static struct adxl345_emul *emul;
+
+/*
+ * emul_int_source - Contenu de INT_SOURCE selon l'état de la FIFO
+ * Doit être appelée avec emul->lock.
+ */
+static u8 emul_int_source(struct adxl345_emul *e)
+{
+    u8 mode = e->regs[EMUL_FIFO_CTL] & EMUL_FIFO_MODE_MASK;
+    u8 source = e->latched;
+
+    if (mode == EMUL_FIFO_BYPASS) {
+        if (e->fresh)
+            source |= EMUL_INT_DATA_READY;
+    } else {
+        if (e->fifo_count)
+            source |= EMUL_INT_DATA_READY;
+        // Un seuil à 0 positionne le watermark en permanence, comme le capteur
+        if (e->fifo_count >= (e->regs[EMUL_FIFO_CTL] & EMUL_FIFO_SAMPLES))
+            source |= EMUL_INT_WATERMARK;
+    }
+    if (e->overrun)
+        source |= EMUL_INT_OVERRUN;
+
+    return source;
+}
+
+/*
+ * emul_update_irq - Calcule les lignes INT1 et INT2
+ *
+ * Une source activée va sur INT2 si son bit de INT_MAP est à 1, sur INT1
+ * sinon. Retourne les lignes sur front montant (BIT(EMUL_INT1/2)).
+ * Doit être appelée avec emul->lock.
+ */
+static u8 emul_update_irq(struct adxl345_emul *e)
+{
+    u8 active = emul_int_source(e) & e->regs[EMUL_INT_ENABLE];
+    const u8 pins[EMUL_INT_LINES] = {
+        [EMUL_INT1] = active & ~e->regs[EMUL_INT_MAP],
+        [EMUL_INT2] = active & e->regs[EMUL_INT_MAP],
+    };
+    u8 rising = 0;
+    int i;
+
+    for (i = 0; i < EMUL_INT_LINES; i++) {
+        if (pins[i] && !e->irq_level[i]) {
+            rising |= BIT(i);
+            e->irqs[i]++;
+        }
+        e->irq_level[i] = pins[i];
+    }
+    return rising;
+}
+
+static void emul_raise_irq(struct adxl345_emul *e, u8 lines)
+{
+    int i;
+
+    for (i = 0; i < EMUL_INT_LINES; i++) {
+        if (lines & BIT(i))
+            irq_set_irqchip_state(e->irq[i], IRQCHIP_STATE_PENDING, true);
+    }
+}
+
+// Période d'échantillonnage réelle : 3200 Hz pour le code 15, /2 par pas
+static u64 emul_period_ns(struct adxl345_emul *e)
+{
+    u8 code = e->regs[EMUL_BW_RATE] & EMUL_RATE_MASK;
+
+    return div_u64(1000000000000ULL, 3200000 >> (15 - code));
+}
+
+/*
+ * emul_waveform - Accélération à l'instant simulé, en mg
+ * Doit être appelée avec emul->lock.
+ */
+static void emul_waveform(struct adxl345_emul *e, s32 mg[3])
+{
+    s32 amp = e->amplitude_mg;
+    u64 mcycles = div_u64(div_u64(e->now_ns, 1000) * e->frequency_mhz, 1000000);
+    u32 phase = do_div(mcycles, 1000);     // mcycles devient le numéro de période
+    int i;
+
+    mg[0] = 0;
+    mg[1] = 0;
+    mg[2] = EMUL_ONE_G_MG;
+
+    switch (e->waveform) {
+    case EMUL_WAVE_STILL:
+        break;
+    case EMUL_WAVE_SINE:
+        mg[0] = ((s64)amp * fixp_sin32(phase * 360 / 1000)) >> 31;
+        break;
+    case EMUL_WAVE_SQUARE:
+        mg[0] = phase < 500 ? amp : -amp;
+        break;
+    case EMUL_WAVE_NOISE:
+        for (i = 0; i < 3; i++)
+            mg[i] += (s32)(get_random_u32() % (2 * amp + 1)) - amp;
+        break;
+    case EMUL_WAVE_TAPS:
+        // Une impulsion d'un échantillon au début de chaque période
+        if (mcycles != e->last_cycle)
+            mg[2] += amp;
+        break;
+    case EMUL_WAVE_FREEFALL:
+        if (phase < 300)
+            mg[2] = 0;
+        break;
+    }
+    e->last_cycle = mcycles;
+
+    if (e->inject_taps) {
+        mg[2] += EMUL_TAP_MG;
+        e->inject_taps--;
+    }
+}
+
+static u32 emul_abs_ug(s32 mg)
+{
+    return abs(mg) * 1000;
+}
+
+/*
+ * emul_detect_tap - Tap et double tap sur les axes de TAP_AXES
+ *
+ * Un tap est un passage au-dessus de THRESH_TAP plus court que DUR. Le
+ * double tap est un second tap après LATENT et avant la fin de WINDOW.
+ */
+static void emul_detect_tap(struct adxl345_emul *e, const s32 mg[3], u64 period)
+{
+    u32 thresh = e->regs[EMUL_THRESH_TAP] * EMUL_THRESH_UG;
+    u8 enabled = e->regs[EMUL_TAP_AXES] & 0x07;
+    u64 since_first;
+    u8 above = 0;
+    int i;
+
+    if (!thresh || !e->regs[EMUL_DUR] || !enabled)
+        return;
+
+    for (i = 0; i < 3; i++)
+        if ((enabled & (4 >> i)) && emul_abs_ug(mg[i]) > thresh)
+            above |= 4 >> i;
+
+    if (above) {
+        if (!e->tap_above)
+            e->tap_start_ns = e->now_ns;
+        e->tap_axes |= above;
+        e->tap_above = true;
+        return;
+    }
+
+    if (!e->tap_above)
+        return;
+    e->tap_above = false;
+
+    // Durée au-dessus du seuil, l'échantillon courant étant déjà redescendu
+    if (e->now_ns - period - e->tap_start_ns > (u64)e->regs[EMUL_DUR] * EMUL_DUR_NS) {
+        e->tap_axes = 0;
+        return;
+    }
+
+    since_first = e->now_ns - e->first_tap_ns;
+    if (e->first_tap_ns && e->regs[EMUL_WINDOW] &&
+        since_first >= (u64)e->regs[EMUL_LATENT] * EMUL_LATENT_NS &&
+        since_first <= (u64)(e->regs[EMUL_LATENT] + e->regs[EMUL_WINDOW]) * EMUL_LATENT_NS) {
+        e->latched |= EMUL_INT_DOUBLE_TAP;
+        e->first_tap_ns = 0;
+    } else {
+        e->latched |= EMUL_INT_SINGLE_TAP;
+        e->first_tap_ns = e->now_ns;
+    }
+
+    e->regs[EMUL_ACT_TAP_STATUS] = (e->regs[EMUL_ACT_TAP_STATUS] & 0x70) | e->tap_axes;
+    e->tap_axes = 0;
+}
+
+// Activité, inactivité (couplage DC ou AC) et chute libre
+static void emul_detect_motion(struct adxl345_emul *e, const s32 mg[3])
+{
+    u8 ctl = e->regs[EMUL_ACT_INACT_CTL];
+    u8 act_en = (ctl >> 4) & 0x07, inact_en = ctl & 0x07;
+    u32 act_thresh = e->regs[EMUL_THRESH_ACT] * EMUL_THRESH_UG;
+    u32 inact_thresh = e->regs[EMUL_THRESH_INACT] * EMUL_THRESH_UG;
+    u32 ff_thresh = e->regs[EMUL_THRESH_FF] * EMUL_THRESH_UG;
+    bool quiet = true, falling = true;
+    u8 act_axes = 0;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        s32 act_mg = (ctl & 0x80) ? mg[i] - e->ref_mg[i] : mg[i];
+        s32 inact_mg = (ctl & 0x08) ? mg[i] - e->ref_mg[i] : mg[i];
+
+        if ((act_en & (4 >> i)) && emul_abs_ug(act_mg) > act_thresh)
+            act_axes |= 4 >> i;
+        if ((inact_en & (4 >> i)) && emul_abs_ug(inact_mg) > inact_thresh)
+            quiet = false;
+        if (emul_abs_ug(mg[i]) >= ff_thresh)
+            falling = false;
+    }
+
+    if (act_thresh && act_axes) {
+        e->latched |= EMUL_INT_ACTIVITY;
+        e->regs[EMUL_ACT_TAP_STATUS] = (e->regs[EMUL_ACT_TAP_STATUS] & 0x0F) | (act_axes << 4);
+        memcpy(e->ref_mg, mg, sizeof(e->ref_mg));
+    }
+
+    if (inact_thresh && inact_en) {
+        if (!quiet) {
+            e->inact_start_ns = e->now_ns;
+            e->inact_fired = false;
+        } else if (!e->inact_fired &&
+                   e->now_ns - e->inact_start_ns >= (u64)e->regs[EMUL_TIME_INACT] * NSEC_PER_SEC) {
+            e->latched |= EMUL_INT_INACTIVITY;
+            e->inact_fired = true;
+            memcpy(e->ref_mg, mg, sizeof(e->ref_mg));
+        }
+    }
+
+    if (ff_thresh && falling) {
+        if (!e->ff_active) {
+            e->ff_start_ns = e->now_ns;
+            e->ff_active = true;
+        }
+        if (!e->ff_fired && e->now_ns - e->ff_start_ns >= (u64)e->regs[EMUL_TIME_FF] * EMUL_FF_NS) {
+            e->latched |= EMUL_INT_FREE_FALL;
+            e->ff_fired = true;
+        }
+    } else {
+        e->ff_active = false;
+        e->ff_fired = false;
+    }
+}
+
+/*
+ * emul_to_lsb - Conversion mg -> LSB selon DATA_FORMAT, offsets compris
+ * Saturation à 10 bits, ou jusqu'à 13 bits en pleine résolution.
+ */
+static s16 emul_to_lsb(struct adxl345_emul *e, s32 mg, int axis)
+{
+    u8 format = e->regs[EMUL_DATA_FORMAT];
+    u8 range = format & EMUL_RANGE_MASK;
+    bool full_res = format & EMUL_FULL_RES;
+    s32 lsb_ug = full_res ? EMUL_LSB_UG : EMUL_LSB_UG << range;
+    s32 max = full_res ? (512 << range) - 1 : 511;
+    s32 ofs_ug = (s8)e->regs[EMUL_OFSX + axis] * EMUL_OFS_UG;
+    s32 lsb = div_s64((s64)mg * 1000 + ofs_ug, lsb_ug);
+
+    return clamp(lsb, -max - 1, max);
+}
+
+// Dépile l'échantillon de tête. Doit être appelée avec emul->lock.
+static void emul_fifo_pop(struct adxl345_emul *e)
+{
+    if (!e->fifo_count)
+        return;
+
+    memcpy(e->last, e->fifo[e->fifo_head], sizeof(e->last));
+    e->fifo_head = (e->fifo_head + 1) % EMUL_FIFO_DEPTH;
+    e->fifo_count--;
+}
+
+/*
+ * emul_fifo_push - Range un échantillon selon le mode de FIFO_CTL
+ *
+ * Bypass : seul le dernier est conservé. FIFO : collecte jusqu'à 32 puis
+ * s'arrête. Stream : le plus ancien est écrasé. Trigger : stream jusqu'à
+ * l'événement, puis FIFO en gardant les 'samples' plus récents.
+ */
+static void emul_fifo_push(struct adxl345_emul *e, const s16 lsb[3])
+{
+    u8 mode = e->regs[EMUL_FIFO_CTL] & EMUL_FIFO_MODE_MASK;
+    unsigned int tail;
+
+    switch (mode) {
+    case EMUL_FIFO_BYPASS:
+        if (e->fresh)
+            e->overrun = true;
+        memcpy(e->last, lsb, sizeof(e->last));
+        e->fresh = true;
+        return;
+    case EMUL_FIFO_FIFO:
+        if (e->fifo_count == EMUL_FIFO_DEPTH)
+            return;
+        break;
+    case EMUL_FIFO_TRIGGER:
+        if (e->triggered && e->fifo_count == EMUL_FIFO_DEPTH)
+            return;
+        fallthrough;
+    case EMUL_FIFO_STREAM:
+        if (e->fifo_count == EMUL_FIFO_DEPTH) {
+            e->fifo_head = (e->fifo_head + 1) % EMUL_FIFO_DEPTH;
+            e->fifo_count--;
+            e->overrun = true;
+        }
+        break;
+    }
+
+    tail = (e->fifo_head + e->fifo_count) % EMUL_FIFO_DEPTH;
+    memcpy(e->fifo[tail], lsb, sizeof(e->fifo[tail]));
+    e->fifo_count++;
+}
+
+// Mode trigger : un événement routé sur la broche choisie fige l'historique
+static void emul_fifo_trigger(struct adxl345_emul *e)
+{
+    u8 ctl = e->regs[EMUL_FIFO_CTL];
+    u8 pin_map = (ctl & EMUL_FIFO_TRIG_INT2) ? e->regs[EMUL_INT_MAP] : ~e->regs[EMUL_INT_MAP];
+    unsigned int keep = ctl & EMUL_FIFO_SAMPLES;
+
+    if ((ctl & EMUL_FIFO_MODE_MASK) != EMUL_FIFO_TRIGGER || e->triggered)
+        return;
+    if (!(e->latched & e->regs[EMUL_INT_ENABLE] & pin_map))
+        return;
+
+    while (e->fifo_count > keep)
+        emul_fifo_pop(e);
+    e->triggered = true;
+}
+
+static enum hrtimer_restart emul_timer_fn(struct hrtimer *timer)
+{
+    struct adxl345_emul *e = container_of(timer, struct adxl345_emul, timer);
+    unsigned long flags;
+    s32 mg[3];
+    s16 lsb[3];
+    u8 raise;
+    u64 period;
+    int i;
+
+    spin_lock_irqsave(&e->lock, flags);
+
+    period = emul_period_ns(e);
+    if (e->regs[EMUL_POWER_CTL] & EMUL_MEASURE) {
+        e->now_ns += period;
+        emul_waveform(e, mg);
+        emul_detect_tap(e, mg, period);
+        emul_detect_motion(e, mg);
+        emul_fifo_trigger(e);
+
+        for (i = 0; i < 3; i++)
+            lsb[i] = emul_to_lsb(e, mg[i], i);
+        emul_fifo_push(e, lsb);
+        e->samples++;
+    }
+    raise = emul_update_irq(e);
+
+    spin_unlock_irqrestore(&e->lock, flags);
+
+    if (raise)
+        emul_raise_irq(e, raise);
+
+    hrtimer_forward_now(timer, ns_to_ktime(div_u64(period, speedup)));
+    return HRTIMER_RESTART;
+}
+
+// Lecture d'un registre. Doit être appelée avec emul->lock.
+static u8 emul_read_reg(struct adxl345_emul *e, u8 reg)
+{
+    bool bypass = (e->regs[EMUL_FIFO_CTL] & EMUL_FIFO_MODE_MASK) == EMUL_FIFO_BYPASS;
+    const s16 *sample = (bypass || !e->fifo_count) ? e->last : e->fifo[e->fifo_head];
+    u8 idx, val;
+
+    switch (reg) {
+    case EMUL_INT_SOURCE:
+        val = emul_int_source(e);
+        e->latched = 0;
+        return val;
+    case EMUL_FIFO_STATUS:
+        return (e->triggered ? EMUL_FIFO_TRIG : 0) | e->fifo_count;
+    case EMUL_DATAX0 ... EMUL_DATAZ1:
+        idx = reg - EMUL_DATAX0;
+        return (idx & 1) ? (u16)sample[idx / 2] >> 8 : (u16)sample[idx / 2] & 0xFF;
+    default:
+        return reg < EMUL_REG_COUNT ? e->regs[reg] : 0;
+    }
+}
+
+// Écriture d'un registre. Doit être appelée avec emul->lock.
+static void emul_write_reg(struct adxl345_emul *e, u8 reg, u8 val)
+{
+    switch (reg) {
+    case EMUL_DEVID:
+    case EMUL_ACT_TAP_STATUS:
+    case EMUL_INT_SOURCE:
+    case EMUL_DATAX0 ... EMUL_DATAZ1:
+    case EMUL_FIFO_STATUS:
+        return;     // Lecture seule
+    case EMUL_FIFO_CTL:
+        // Changement de mode : la FIFO est vidée, le trigger réarmé
+        if ((val ^ e->regs[reg]) & EMUL_FIFO_MODE_MASK) {
+            e->fifo_count = 0;
+            e->fresh = false;
+            e->overrun = false;
+            e->triggered = false;
+        }
+        break;
+    default:
+        if (reg >= EMUL_REG_COUNT)
+            return;
+        break;
+    }
+
+    e->regs[reg] = val;
+}
+
+/*
+ * emul_access - Une transaction sur le bus (I2C ou SPI)
+ * @reg: premier registre
+ * @incr: adresse auto-incrémentée (toujours en I2C, bit MB en SPI)
+ *
+ * Une lecture touchant les registres de données dépile un échantillon en
+ * fin de transaction, comme le capteur au STOP ou au relâchement de CS.
+ * Retourne les lignes d'interruption à lever.
+ */
+static u8 emul_access(struct adxl345_emul *e, u8 reg, bool read, u8 *buf, unsigned int len, bool incr)
+{
+    bool data_read = false;
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        if (read) {
+            if (reg >= EMUL_DATAX0 && reg <= EMUL_DATAZ1)
+                data_read = true;
+            buf[i] = emul_read_reg(e, reg);
+        } else {
+            emul_write_reg(e, reg, buf[i]);
+        }
+
+        if (incr)
+            reg = (reg + 1) & EMUL_SPI_ADDR_MASK;
+    }
+
+    if (data_read) {
+        e->fresh = false;
+        e->overrun = false;
+        if ((e->regs[EMUL_FIFO_CTL] & EMUL_FIFO_MODE_MASK) != EMUL_FIFO_BYPASS)
+            emul_fifo_pop(e);
+    }
+    e->transfers++;
+
+    return emul_update_irq(e);
+}
+
+/*
+ * emul_i2c_xfer - Adaptateur I2C virtuel
+ *
+ * Écriture [reg, données...] pour programmer, écriture [reg] suivie d'une
+ * lecture avec restart pour lire. Le SMBus est émulé par le cœur I2C.
+ */
+static int emul_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+    struct adxl345_emul *e = i2c_get_adapdata(adap);
+    unsigned long flags;
+    u8 raise = 0;
+    u8 reg = 0;
+    int i;
+
+    for (i = 0; i < num; i++) {
+        if (msgs[i].addr != EMUL_I2C_ADDR)
+            return -ENXIO;
+    }
+
+    spin_lock_irqsave(&e->lock, flags);
+    for (i = 0; i < num; i++) {
+        struct i2c_msg *msg = &msgs[i];
+
+        if (msg->flags & I2C_M_RD) {
+            raise |= emul_access(e, reg, true, msg->buf, msg->len, true);
+        } else if (msg->len) {
+            reg = msg->buf[0];
+            if (msg->len > 1)
+                raise |= emul_access(e, reg, false, msg->buf + 1, msg->len - 1, true);
+        }
+    }
+    spin_unlock_irqrestore(&e->lock, flags);
+
+    if (raise)
+        emul_raise_irq(e, raise);
+
+    return num;
+}
+
+static u32 emul_i2c_func(struct i2c_adapter *adap)
+{
+    return I2C_FUNC_I2C | I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_I2C_BLOCK;
+}
+
+static const struct i2c_algorithm emul_i2c_algo = {
+    .master_xfer = emul_i2c_xfer,
+    .functionality = emul_i2c_func,
+};
+
+/*
+ * emul_spi_transfer - Un message = une transaction CS bas
+ * Premier octet émis : commande (R/W, MB, adresse), puis les données.
+ */
+static int emul_spi_transfer(struct spi_controller *ctlr, struct spi_message *msg)
+{
+    struct adxl345_emul *e = spi_controller_get_devdata(ctlr);
+    struct spi_transfer *xfer;
+    unsigned long flags;
+    bool have_cmd = false, read = false, mb = false;
+    u8 raise = 0;
+    u8 reg = 0;
+
+    spin_lock_irqsave(&e->lock, flags);
+
+    list_for_each_entry(xfer, &msg->transfers, transfer_list) {
+        const u8 *tx = xfer->tx_buf;
+        u8 *rx = xfer->rx_buf;
+        unsigned int skip = 0;
+        u8 data[EMUL_REG_COUNT];
+        unsigned int len;
+
+        if (!have_cmd && tx && xfer->len) {
+            read = tx[0] & EMUL_SPI_READ;
+            mb = tx[0] & EMUL_SPI_MB;
+            reg = tx[0] & EMUL_SPI_ADDR_MASK;
+            have_cmd = true;
+            if (rx)
+                rx[0] = 0;
+            skip = 1;
+        }
+
+        len = min_t(unsigned int, xfer->len - skip, sizeof(data));
+        if (have_cmd && len) {
+            if (!read && tx)
+                memcpy(data, tx + skip, len);
+            raise |= emul_access(e, reg, read, data, len, mb);
+            if (read && rx)
+                memcpy(rx + skip, data, len);
+            if (mb)
+                reg = (reg + len) & EMUL_SPI_ADDR_MASK;
+        }
+        msg->actual_length += xfer->len;
+    }
+
+    spin_unlock_irqrestore(&e->lock, flags);
+
+    if (raise)
+        emul_raise_irq(e, raise);
+
+    msg->status = 0;
+    spi_finalize_current_message(ctlr);
+    return 0;
+}
+
+static void emul_reset(struct adxl345_emul *e)
+{
+    memset(e->regs, 0, sizeof(e->regs));
+    e->regs[EMUL_DEVID] = EMUL_DEVID_VAL;
+    e->regs[EMUL_BW_RATE] = EMUL_RATE_100HZ;
+    e->waveform = EMUL_WAVE_STILL;
+    e->amplitude_mg = 500;
+    e->frequency_mhz = 1000;
+}
+
+// Paramètres de la forme d'onde, sur le device plateforme
+static ssize_t waveform_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%s\n", emul_waveform_names[READ_ONCE(emul->waveform)]);
+}
+
+static ssize_t waveform_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    int ret = sysfs_match_string(emul_waveform_names, buf);
+
+    if (ret < 0)
+        return ret;
+
+    WRITE_ONCE(emul->waveform, ret);
+    return count;
+}
+
+static ssize_t amplitude_mg_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", READ_ONCE(emul->amplitude_mg));
+}
+
+static ssize_t amplitude_mg_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int val;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &val);
+    if (ret)
+        return ret;
+    // Au-delà de 16 g le capteur sature de toute façon
+    if (val > 16000)
+        return -ERANGE;
+
+    WRITE_ONCE(emul->amplitude_mg, val);
+    return count;
+}
+
+static ssize_t frequency_mhz_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", READ_ONCE(emul->frequency_mhz));
+}
+
+static ssize_t frequency_mhz_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int val;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &val);
+    if (ret)
+        return ret;
+    if (val > 1600000)
+        return -ERANGE;
+
+    WRITE_ONCE(emul->frequency_mhz, val);
+    return count;
+}
+
+// Écrire N injecte N impulsions sur Z, une par échantillon
+static ssize_t tap_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned long flags;
+    unsigned int val;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &val);
+    if (ret)
+        return ret;
+
+    spin_lock_irqsave(&emul->lock, flags);
+    emul->inject_taps += val;
+    spin_unlock_irqrestore(&emul->lock, flags);
+
+    return count;
+}
+
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    unsigned long flags;
+    u64 samples, irqs, irqs_int2, transfers;
+
+    spin_lock_irqsave(&emul->lock, flags);
+    samples = emul->samples;
+    irqs = emul->irqs[EMUL_INT1];
+    irqs_int2 = emul->irqs[EMUL_INT2];
+    transfers = emul->transfers;
+    spin_unlock_irqrestore(&emul->lock, flags);
+
+    return sprintf(buf, "samples %llu\nirqs %llu\nirqs_int2 %llu\ntransfers %llu\n",
+                   samples, irqs, irqs_int2, transfers);
+}
+
+static DEVICE_ATTR_RW(waveform);
+static DEVICE_ATTR_RW(amplitude_mg);
+static DEVICE_ATTR_RW(frequency_mhz);
+static DEVICE_ATTR_WO(tap);
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute *emul_attrs[] = {
+    &dev_attr_waveform.attr,
+    &dev_attr_amplitude_mg.attr,
+    &dev_attr_frequency_mhz.attr,
+    &dev_attr_tap.attr,
+    &dev_attr_stats.attr,
+    NULL,
+};
+
+static const struct attribute_group emul_attr_group = {
+    .attrs = emul_attrs,
+};
+
+// Propriété lue par le driver sur le parent de l'adaptateur I2C
+static const struct property_entry emul_props[] = {
+    PROPERTY_ENTRY_U32("clock-frequency", EMUL_I2C_HZ),
+    { }
+};
+
+/*
+ * emul_client_node - Propriétés du capteur, NULL sans int2
+ *
+ * Un software node ne peut pas décrire d'interruption (interrupt-names) :
+ * le driver lit le numéro Linux de la ligne INT2 dans linux,int2-irq. Le
+ * node est enregistré avec le device et retiré avec lui.
+ */
+static const struct software_node *emul_client_node(struct adxl345_emul *e)
+{
+    if (!int2)
+        return NULL;
+
+    e->client_props[0] = PROPERTY_ENTRY_U32("linux,int2-irq", e->irq[EMUL_INT2]);
+    e->client_node.properties = e->client_props;
+    return &e->client_node;
+}
+
+static int emul_add_i2c(struct adxl345_emul *e)
+{
+    struct i2c_board_info info = {
+        I2C_BOARD_INFO("drv2025", EMUL_I2C_ADDR),
+        .irq = e->irq[EMUL_INT1],
+    };
+    int ret;
+
+    info.swnode = emul_client_node(e);
+    e->adapter.owner = THIS_MODULE;
+    e->adapter.algo = &emul_i2c_algo;
+    e->adapter.dev.parent = &e->pdev->dev;
+    strscpy(e->adapter.name, DRV_NAME, sizeof(e->adapter.name));
+    i2c_set_adapdata(&e->adapter, e);
+
+    ret = i2c_add_adapter(&e->adapter);
+    if (ret)
+        return ret;
+
+    e->client = i2c_new_client_device(&e->adapter, &info);
+    if (IS_ERR(e->client)) {
+        i2c_del_adapter(&e->adapter);
+        return PTR_ERR(e->client);
+    }
+
+    pr_info("ADXL345 émulé sur %s, adresse 0x%02x (IRQ %d)\n",
+            dev_name(&e->adapter.dev), EMUL_I2C_ADDR, e->irq[EMUL_INT1]);
+    return 0;
+}
+
+static int emul_add_spi(struct adxl345_emul *e)
+{
+    struct spi_board_info info = {
+        .modalias = "adxl345",
+        .max_speed_hz = EMUL_SPI_HZ,
+        .mode = SPI_MODE_3,
+        .chip_select = 0,
+        .irq = e->irq[EMUL_INT1],
+    };
+    struct spi_controller *ctlr;
+    int ret;
+
+    info.swnode = emul_client_node(e);
+    ctlr = spi_alloc_master(&e->pdev->dev, 0);
+    if (!ctlr)
+        return -ENOMEM;
+
+    spi_controller_set_devdata(ctlr, e);
+    ctlr->bus_num = -1;
+    ctlr->num_chipselect = 1;
+    ctlr->mode_bits = SPI_CPOL | SPI_CPHA;
+    ctlr->max_speed_hz = EMUL_SPI_HZ;
+    ctlr->transfer_one_message = emul_spi_transfer;
+
+    ret = spi_register_controller(ctlr);
+    if (ret) {
+        spi_controller_put(ctlr);
+        return ret;
+    }
+    e->ctlr = ctlr;
+
+    if (!spi_new_device(ctlr, &info)) {
+        spi_unregister_controller(ctlr);
+        e->ctlr = NULL;
+        return -ENODEV;
+    }
+
+    pr_info("ADXL345 émulé sur le bus SPI %d (IRQ %d)\n", ctlr->bus_num, e->irq[EMUL_INT1]);
+    return 0;
+}
+
+// Libère les lignes simulées, irq_dispose_mapping(0) ne fait rien
+static void emul_dispose_irqs(struct adxl345_emul *e)
+{
+    int i;
+
+    for (i = 0; i < EMUL_INT_LINES; i++)
+        irq_dispose_mapping(e->irq[i]);
+}
+
+// Retire le device du bus, donc le driver adxl345 qui y est lié
+static void emul_del_bus(struct adxl345_emul *e)
+{
+    if (e->ctlr) {
+        spi_unregister_controller(e->ctlr);
+    } else {
+        i2c_unregister_device(e->client);
+        i2c_del_adapter(&e->adapter);
+    }
+}
+
+static int __init adxl345_emul_init(void)
+{
+    struct platform_device_info pdev_info = {
+        .name = DRV_NAME,
+        .id = PLATFORM_DEVID_NONE,
+        .properties = emul_props,
+    };
+    int ret;
+    int i;
+
+    if (strcmp(bus, "i2c") && strcmp(bus, "spi")) {
+        pr_err("Bus inconnu: %s (i2c ou spi)\n", bus);
+        return -EINVAL;
+    }
+    if (speedup < 1 || speedup > 64) {
+        pr_err("speedup hors limites: %u (1..64)\n", speedup);
+        return -EINVAL;
+    }
+
+    emul = kzalloc(sizeof(*emul), GFP_KERNEL);
+    if (!emul)
+        return -ENOMEM;
+
+    spin_lock_init(&emul->lock);
+    emul_reset(emul);
+
+    // Parent de l'adaptateur ou du contrôleur, porte les attributs sysfs
+    emul->pdev = platform_device_register_full(&pdev_info);
+    if (IS_ERR(emul->pdev)) {
+        ret = PTR_ERR(emul->pdev);
+        goto err_free;
+    }
+
+    ret = sysfs_create_group(&emul->pdev->dev.kobj, &emul_attr_group);
+    if (ret)
+        goto err_pdev;
+
+    // Lignes INT1 et INT2 simulées
+    emul->irq_domain = irq_domain_create_sim(NULL, EMUL_INT_LINES);
+    if (IS_ERR(emul->irq_domain)) {
+        ret = PTR_ERR(emul->irq_domain);
+        goto err_sysfs;
+    }
+
+    for (i = 0; i < EMUL_INT_LINES; i++) {
+        emul->irq[i] = irq_create_mapping(emul->irq_domain, i);
+        if (!emul->irq[i]) {
+            ret = -ENXIO;
+            goto err_mapping;
+        }
+    }
+
+    hrtimer_init(&emul->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    emul->timer.function = emul_timer_fn;
+    hrtimer_start(&emul->timer, ns_to_ktime(emul_period_ns(emul)), HRTIMER_MODE_REL);
+
+    ret = strcmp(bus, "spi") ? emul_add_i2c(emul) : emul_add_spi(emul);
+    if (ret) {
+        pr_err("Erreur création du capteur émulé: %d\n", ret);
+        goto err_timer;
+    }
+
+    return 0;
+
+err_timer:
+    hrtimer_cancel(&emul->timer);
+err_mapping:
+    emul_dispose_irqs(emul);
+    irq_domain_remove_sim(emul->irq_domain);
+err_sysfs:
+    sysfs_remove_group(&emul->pdev->dev.kobj, &emul_attr_group);
+err_pdev:
+    platform_device_unregister(emul->pdev);
+err_free:
+    kfree(emul);
+    return ret;
+}
+
+static void __exit adxl345_emul_exit(void)
+{
+    emul_del_bus(emul);
+    hrtimer_cancel(&emul->timer);
+    emul_dispose_irqs(emul);
+    irq_domain_remove_sim(emul->irq_domain);
+    sysfs_remove_group(&emul->pdev->dev.kobj, &emul_attr_group);
+    platform_device_unregister(emul->pdev);
+    kfree(emul);
+}
+
+module_init(adxl345_emul_init);
+module_exit(adxl345_emul_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Thomas Stäheli");
+MODULE_DESCRIPTION("ADXL345 émulé sur un bus I2C ou SPI virtuel");
@@ -0,0 +1,92 @@
+/*
+ * Author : Thomas Stäheli
+ *
+ * Front-end I2C du driver ADXL345
+*/
+#include <linux/i2c.h>
+#include <linux/property.h>
+#include <linux/math64.h>
+
+#include "adxl345_core.h"
+
+#define DRV_NAME "adxl345"
+
+// Coût d'un échantillon sur le bus I2C (adresse, registre, restart, 6 octets,
+// marge incluse) : 400 kHz -> 1000 Hz max, soit 800 Hz comme la datasheet
+#define ADXL345_I2C_BITS_PER_SAMPLE     400
+#define ADXL345_I2C_DEFAULT_HZ          100000
+
+static int adxl345_i2c_read_regs(struct device *dev, u8 reg, u8 len, u8 *buf)
+{
+    int ret;
+
+    // Lecture multi-octets : le capteur incrémente l'adresse de registre
+    ret = i2c_smbus_read_i2c_block_data(to_i2c_client(dev), reg, len, buf);
+    if (ret != len)
+        return ret < 0 ? ret : -EIO;
+
+    return 0;
+}
+
+static int adxl345_i2c_write_reg(struct device *dev, u8 reg, u8 val)
+{
+    return i2c_smbus_write_byte_data(to_i2c_client(dev), reg, val);
+}
+
+static int adxl345_i2c_write_regs(struct device *dev, u8 reg, u8 len, const u8 *buf)
+{
+    // Écriture en rafale, adresse auto-incrémentée comme en lecture
+    return i2c_smbus_write_i2c_block_data(to_i2c_client(dev), reg, len, buf);
+}
+
+static const struct adxl345_bus_ops adxl345_i2c_bus = {
+    .read_regs = adxl345_i2c_read_regs,
+    .write_reg = adxl345_i2c_write_reg,
+    .write_regs = adxl345_i2c_write_regs,
+};
+
+static int adxl345_i2c_probe(struct i2c_client *client, const struct i2c_device_id *id)
+{
+    u32 bus_hz;
+
+    // Débit max selon la fréquence du bus I2C (propriété du contrôleur)
+    if (device_property_read_u32(client->adapter->dev.parent, "clock-frequency", &bus_hz))
+        bus_hz = ADXL345_I2C_DEFAULT_HZ;
+
+    return adxl345_core_probe(&client->dev, client->irq, &adxl345_i2c_bus,
+                              div_u64((u64)bus_hz * 1000, ADXL345_I2C_BITS_PER_SAMPLE));
+}
+
+static void adxl345_i2c_remove(struct i2c_client *client)
+{
+    adxl345_core_remove(&client->dev);
+}
+
+static const struct i2c_device_id adxl345_i2c_id[] = {
+    { "drv2025", 0 },
+    { }
+};
+MODULE_DEVICE_TABLE(i2c, adxl345_i2c_id);
+
+static struct i2c_driver adxl345_i2c_driver = {
+    .driver = {
+        .name = DRV_NAME,
+        .of_match_table = adxl345_of_match,
+        .pm = pm_ptr(&adxl345_pm_ops),
+        // Probe (lecture du DT + écritures de configuration) hors du thread principal
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,
+    },
+    .probe = adxl345_i2c_probe,
+    .remove = adxl345_i2c_remove,
+    .id_table = adxl345_i2c_id,
+};
+
+int adxl345_i2c_register(void)
+{
+    return i2c_add_driver(&adxl345_i2c_driver);
+}
+
+void adxl345_i2c_unregister(void)
+{
+    i2c_del_driver(&adxl345_i2c_driver);
+}
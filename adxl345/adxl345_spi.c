@@ -0,0 +1,110 @@
+/*
+ * Author : Thomas Stäheli
+ *
+ * Front-end SPI 4 fils du driver ADXL345 (mode 3, 5 MHz max)
+*/
+#include <linux/spi/spi.h>
+#include <linux/math64.h>
+
+#include "adxl345_core.h"
+
+#define DRV_NAME "adxl345"
+
+// Premier octet d'une transaction : R/W, MB puis adresse sur 6 bits
+#define ADXL345_SPI_READ        (1 << 7)
+#define ADXL345_SPI_MB          (1 << 6)   // Multi-octets : adresse auto-incrémentée
+#define ADXL345_SPI_MAX_BURST   32
+
+#define ADXL345_SPI_MAX_HZ      5000000
+// Coût d'un échantillon : octet de commande + 6 octets, CS et marge inclus
+#define ADXL345_SPI_BITS_PER_SAMPLE     80
+
+static int adxl345_spi_read_regs(struct device *dev, u8 reg, u8 len, u8 *buf)
+{
+    u8 cmd = reg | ADXL345_SPI_READ;
+
+    if (len > 1)
+        cmd |= ADXL345_SPI_MB;
+
+    // Une seule transaction CS bas : commande puis len octets en rafale
+    return spi_write_then_read(to_spi_device(dev), &cmd, 1, buf, len);
+}
+
+static int adxl345_spi_write_reg(struct device *dev, u8 reg, u8 val)
+{
+    u8 tx[2] = { reg, val };
+
+    // spi_write_then_read copie dans un tampon DMA-safe, tx peut rester sur la pile
+    return spi_write_then_read(to_spi_device(dev), tx, sizeof(tx), NULL, 0);
+}
+
+static int adxl345_spi_write_regs(struct device *dev, u8 reg, u8 len, const u8 *buf)
+{
+    u8 tx[ADXL345_SPI_MAX_BURST + 1];
+
+    if (len > ADXL345_SPI_MAX_BURST)
+        return -EINVAL;
+
+    tx[0] = reg | (len > 1 ? ADXL345_SPI_MB : 0);
+    memcpy(&tx[1], buf, len);
+
+    return spi_write_then_read(to_spi_device(dev), tx, len + 1, NULL, 0);
+}
+
+static const struct adxl345_bus_ops adxl345_spi_bus = {
+    .read_regs = adxl345_spi_read_regs,
+    .write_reg = adxl345_spi_write_reg,
+    .write_regs = adxl345_spi_write_regs,
+};
+
+static int adxl345_spi_probe(struct spi_device *spi)
+{
+    int ret;
+
+    // CPOL = CPHA = 1, fréquence limitée à ce que supporte le capteur
+    spi->mode |= SPI_MODE_3;
+    if (!spi->max_speed_hz || spi->max_speed_hz > ADXL345_SPI_MAX_HZ)
+        spi->max_speed_hz = ADXL345_SPI_MAX_HZ;
+
+    ret = spi_setup(spi);
+    if (ret) {
+        dev_err(&spi->dev, "Erreur configuration SPI\n");
+        return ret;
+    }
+
+    return adxl345_core_probe(&spi->dev, spi->irq, &adxl345_spi_bus,
+                              div_u64((u64)spi->max_speed_hz * 1000, ADXL345_SPI_BITS_PER_SAMPLE));
+}
+
+static void adxl345_spi_remove(struct spi_device *spi)
+{
+    adxl345_core_remove(&spi->dev);
+}
+
+static const struct spi_device_id adxl345_spi_id[] = {
+    { DRV_NAME, 0 },
+    { }
+};
+MODULE_DEVICE_TABLE(spi, adxl345_spi_id);
+
+static struct spi_driver adxl345_spi_driver = {
+    .driver = {
+        .name = DRV_NAME,
+        .of_match_table = adxl345_of_match,
+        .pm = pm_ptr(&adxl345_pm_ops),
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,
+    },
+    .probe = adxl345_spi_probe,
+    .remove = adxl345_spi_remove,
+    .id_table = adxl345_spi_id,
+};
+
+int adxl345_spi_register(void)
+{
+    return spi_register_driver(&adxl345_spi_driver);
+}
+
+void adxl345_spi_unregister(void)
+{
+    spi_unregister_driver(&adxl345_spi_driver);
+}
@@ -0,0 +1,127 @@
+/*
+ * Author : Thomas Stäheli
+ *
+ * Tracepoints du driver ADXL345, pour suivre la latence tap -> application
+ * sans ralentir le chemin critique :
+ *
+ *   echo 1 > /sys/kernel/tracing/events/adxl345/enable
+ *   cat /sys/kernel/tracing/trace_pipe
+*/
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM adxl345
+
+#if !defined(_ADXL345_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ADXL345_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// Entrée du thread d'IRQ, avec l'horodatage pris par le handler primaire
+TRACE_EVENT(adxl345_irq,
+    TP_PROTO(int sensor, u64 irq_ts),
+    TP_ARGS(sensor, irq_ts),
+    TP_STRUCT__entry(
+        __field(int, sensor)
+        __field(u64, irq_ts)
+    ),
+    TP_fast_assign(
+        __entry->sensor = sensor;
+        __entry->irq_ts = irq_ts;
+    ),
+    TP_printk("sensor=%d irq_ts=%llu", __entry->sensor, __entry->irq_ts)
+);
+
+// Transaction sur le bus (I2C ou SPI) : début et fin
+DECLARE_EVENT_CLASS(adxl345_bus,
+    TP_PROTO(int sensor, u8 reg, u8 len, bool write, int ret),
+    TP_ARGS(sensor, reg, len, write, ret),
+    TP_STRUCT__entry(
+        __field(int, sensor)
+        __field(u8, reg)
+        __field(u8, len)
+        __field(bool, write)
+        __field(int, ret)
+    ),
+    TP_fast_assign(
+        __entry->sensor = sensor;
+        __entry->reg = reg;
+        __entry->len = len;
+        __entry->write = write;
+        __entry->ret = ret;
+    ),
+    TP_printk("sensor=%d %s reg=0x%02x len=%u ret=%d", __entry->sensor,
+              __entry->write ? "write" : "read", __entry->reg, __entry->len, __entry->ret)
+);
+
+DEFINE_EVENT(adxl345_bus, adxl345_bus_start,
+    TP_PROTO(int sensor, u8 reg, u8 len, bool write, int ret),
+    TP_ARGS(sensor, reg, len, write, ret)
+);
+
+DEFINE_EVENT(adxl345_bus, adxl345_bus_end,
+    TP_PROTO(int sensor, u8 reg, u8 len, bool write, int ret),
+    TP_ARGS(sensor, reg, len, write, ret)
+);
+
+// Événement (tap, activité...) mis dans les files des abonnés
+TRACE_EVENT(adxl345_event_queued,
+    TP_PROTO(int sensor, u8 type, u8 axes, u64 timestamp),
+    TP_ARGS(sensor, type, axes, timestamp),
+    TP_STRUCT__entry(
+        __field(int, sensor)
+        __field(u8, type)
+        __field(u8, axes)
+        __field(u64, timestamp)
+    ),
+    TP_fast_assign(
+        __entry->sensor = sensor;
+        __entry->type = type;
+        __entry->axes = axes;
+        __entry->timestamp = timestamp;
+    ),
+    TP_printk("sensor=%d type=%u axes=0x%x ts=%llu", __entry->sensor,
+              __entry->type, __entry->axes, __entry->timestamp)
+);
+
+// Réveil des lecteurs après l'ajout d'une salve d'échantillons
+TRACE_EVENT(adxl345_readers_woken,
+    TP_PROTO(int sensor, unsigned int pushed, unsigned int available),
+    TP_ARGS(sensor, pushed, available),
+    TP_STRUCT__entry(
+        __field(int, sensor)
+        __field(unsigned int, pushed)
+        __field(unsigned int, available)
+    ),
+    TP_fast_assign(
+        __entry->sensor = sensor;
+        __entry->pushed = pushed;
+        __entry->available = available;
+    ),
+    TP_printk("sensor=%d pushed=%u available=%u", __entry->sensor,
+              __entry->pushed, __entry->available)
+);
+
+// Retour de read() sur /dev/adxl345 ou /dev/adxl345_events
+TRACE_EVENT(adxl345_read_done,
+    TP_PROTO(int sensor, bool events, ssize_t ret),
+    TP_ARGS(sensor, events, ret),
+    TP_STRUCT__entry(
+        __field(int, sensor)
+        __field(bool, events)
+        __field(ssize_t, ret)
+    ),
+    TP_fast_assign(
+        __entry->sensor = sensor;
+        __entry->events = events;
+        __entry->ret = ret;
+    ),
+    TP_printk("sensor=%d %s ret=%zd", __entry->sensor,
+              __entry->events ? "events" : "data", __entry->ret)
+);
+
+#endif /* _ADXL345_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE adxl345_trace
+#include <trace/define_trace.h>
@@ -6,6 +6,8 @@
 #include <linux/uaccess.h>
 #include <linux/mutex.h>
 #include <linux/device.h>
+#include <linux/wait.h>
+#include <linux/ktime.h>
 
 #define DRV_NAME "adxl345"
 
@@ -22,23 +24,98 @@
 #define ADXL345_SLEEP_MODE     0x00
 
 // Specifications
-// ±4 g, 10-bit resolution (datasheet)
-#define ADXL345_4G_RES_10_BITS  8 // 7.8 typical dans la datasheet
+// ±4 g, 10-bit resolution (datasheet) : 7.8 mg/LSB, en Q10 (x1024) comme
+// la table d'échelles du driver adxl345/
+#define ADXL345_4G_RES_10_BITS  7987
+#define ADXL345_SCALE_SHIFT     10
+
+// Âge max du dernier échantillon partagé entre lecteurs : une période
+// de l'ODR au démarrage du capteur (100 Hz)
+#define ADXL345_MAX_AGE_US_DEFAULT  10000
+#define ADXL345_DATA_LEN            6
 
 struct adxl345_data {
     struct i2c_client *client;
     struct miscdevice miscdev;
+    // Protège le cache ci-dessous, jamais tenu pendant une transaction I2C
     struct mutex lock;
+    u8 sample[ADXL345_DATA_LEN];  // DATAX0..DATAZ1 de la dernière lecture
+    u64 sample_ts;                // Instant de la dernière lecture, 0 : aucune
+    int sample_err;               // Résultat de la dernière lecture
+    bool reading;                 // Une lecture est en cours sur le bus
+    u32 generation;               // Incrémenté à la fin de chaque lecture
+    wait_queue_head_t sample_wait;
+    u32 max_age_us;               // 0 : pas de cache, seulement le partage
 };
 
+/*
+ * adxl345_get_sample - Dernier échantillon, lu sur le bus si trop ancien
+ *
+ * Un échantillon de moins de max_age_us est servi depuis le cache. Sinon
+ * un seul lecteur lance la transaction ; ceux qui arrivent pendant qu'elle
+ * est en cours attendent son résultat au lieu d'en lancer une autre.
+ */
+static int adxl345_get_sample(struct adxl345_data *priv, u8 *data_regs)
+{
+    u32 generation;
+    int ret;
+
+    mutex_lock(&priv->lock);
+
+    while (priv->reading) {
+        // Lecture en cours : attendre et prendre son résultat
+        generation = priv->generation;
+        mutex_unlock(&priv->lock);
+
+        ret = wait_event_interruptible(priv->sample_wait, READ_ONCE(priv->generation) != generation);
+        if (ret)
+            return ret;
+
+        mutex_lock(&priv->lock);
+        if (priv->generation != generation) {
+            ret = priv->sample_err;
+            memcpy(data_regs, priv->sample, ADXL345_DATA_LEN);
+            mutex_unlock(&priv->lock);
+            return ret;
+        }
+    }
+
+    if (priv->sample_ts && !priv->sample_err &&
+        ktime_get_ns() - priv->sample_ts <= (u64)READ_ONCE(priv->max_age_us) * NSEC_PER_USEC) {
+        memcpy(data_regs, priv->sample, ADXL345_DATA_LEN);
+        mutex_unlock(&priv->lock);
+        return 0;
+    }
+
+    priv->reading = true;
+    mutex_unlock(&priv->lock);
+
+    // Lecture des 6 registres qui contiennent les axes X Y et Z
+    ret = i2c_smbus_read_i2c_block_data(priv->client, ADXL345_DATAX0, ADXL345_DATA_LEN, data_regs);
+    if (ret >= 0)
+        ret = (ret == ADXL345_DATA_LEN) ? 0 : -EIO;
+
+    mutex_lock(&priv->lock);
+    if (ret == 0) {
+        memcpy(priv->sample, data_regs, ADXL345_DATA_LEN);
+        priv->sample_ts = ktime_get_ns();
+    }
+    priv->sample_err = ret;
+    priv->reading = false;
+    priv->generation++;
+    mutex_unlock(&priv->lock);
+
+    wake_up_interruptible_all(&priv->sample_wait);
+    return ret;
+}
+
 static ssize_t adxl345_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
 {
     struct adxl345_data *priv = container_of(file->private_data, struct adxl345_data, miscdev);
 
-    loff_t pos = *ppos;
     // Variable to stock DATAX0 to DATAZ1
-    u8 data_regs[6];
-    int data_x, data_y, data_z;
+    u8 data_regs[ADXL345_DATA_LEN];
+    s16 data_x, data_y, data_z;
     unsigned int abs_x, abs_y, abs_z;
     int ret;
     unsigned int len;
@@ -50,31 +127,29 @@ static ssize_t adxl345_read(struct file *file, char __user *buf, size_t count, l
 		return 0;
 	}
 
-    mutex_lock(&priv->lock);
-    // Lecture des 6 registres qui contiennent les axes X Y et Z
-    ret = i2c_smbus_read_i2c_block_data(priv->client, ADXL345_DATAX0, sizeof(data_regs), data_regs);
-    mutex_unlock(&priv->lock);
-
-    if(!ret) {
+    ret = adxl345_get_sample(priv, data_regs);
+    if (ret == -ERESTARTSYS)
+        return ret;
+    if (ret < 0) {
         pr_info("Error while reading data block\n");
         return 0;
     }
 
-    // Cast en int obligatoire, sinon on perd les valeurs
-    data_x = (((int)data_regs[1] << 8) | data_regs[0]);
-    data_y = (((int)data_regs[3] << 8) | data_regs[2]);
-    data_z = (((int)data_regs[5] << 8) | data_regs[4]);
-    // Dans la datasheet, 
-    data_x *= ADXL345_4G_RES_10_BITS;
-    data_y *= ADXL345_4G_RES_10_BITS;
-    data_z *= ADXL345_4G_RES_10_BITS;
+    // Cast en s16 obligatoire, sinon on perd le signe
+    data_x = (s16)((data_regs[1] << 8) | data_regs[0]);
+    data_y = (s16)((data_regs[3] << 8) | data_regs[2]);
+    data_z = (s16)((data_regs[5] << 8) | data_regs[4]);
+    // Conversion en mg sur la valeur absolue : une multiplication et un décalage
+    abs_x = (abs(data_x) * ADXL345_4G_RES_10_BITS) >> ADXL345_SCALE_SHIFT;
+    abs_y = (abs(data_y) * ADXL345_4G_RES_10_BITS) >> ADXL345_SCALE_SHIFT;
+    abs_z = (abs(data_z) * ADXL345_4G_RES_10_BITS) >> ADXL345_SCALE_SHIFT;
 
 	// Update the file position
     len = snprintf(output, sizeof(output),
                   "X = %c%u.%03u; Y = %c%u.%03u; Z = %c%u.%03u\n",
-                  data_x < 0 ? ' ' : '+', data_x / 1000, data_x % 1000,
-                  data_y < 0 ? ' ' : '+', data_y / 1000, data_y % 1000,
-                  data_z < 0 ? ' ' : '+', data_z / 1000, data_z % 1000);
+                  data_x < 0 ? '-' : '+', abs_x / 1000, abs_x % 1000,
+                  data_y < 0 ? '-' : '+', abs_y / 1000, abs_y % 1000,
+                  data_z < 0 ? '-' : '+', abs_z / 1000, abs_z % 1000);
 
     if (len <= 0)
         return -EIO;
@@ -92,6 +167,36 @@ static ssize_t adxl345_read(struct file *file, char __user *buf, size_t count, l
     return count;
 }
 
+static ssize_t max_age_us_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+
+    return sprintf(buf, "%u\n", READ_ONCE(priv->max_age_us));
+}
+
+static ssize_t max_age_us_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct adxl345_data *priv = dev_get_drvdata(dev);
+    unsigned int val;
+    int ret;
+
+    ret = kstrtouint(buf, 0, &val);
+    if (ret)
+        return ret;
+
+    WRITE_ONCE(priv->max_age_us, val);
+    return count;
+}
+
+// /sys/bus/i2c/devices/0-0053/max_age_us
+static DEVICE_ATTR_RW(max_age_us);
+
+static struct attribute *adxl345_attrs[] = {
+    &dev_attr_max_age_us.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(adxl345);
+
 static const struct file_operations adxl345_fops = {
     .owner = THIS_MODULE,
     .read = adxl345_read,
@@ -118,6 +223,8 @@ static int adxl345_probe(struct i2c_client *client, const struct i2c_device_id *
 
     priv->client = client;
     mutex_init(&priv->lock);
+    init_waitqueue_head(&priv->sample_wait);
+    priv->max_age_us = ADXL345_MAX_AGE_US_DEFAULT;
     i2c_set_clientdata(client, priv);
 
     // Configuration DATA_FORMAT (+ ou - 4g)
@@ -181,6 +288,7 @@ static struct i2c_driver adxl345_driver = {
     .driver = {
         .name = DRV_NAME,
         .of_match_table = adxl345_of_match,
+        .dev_groups = adxl345_groups,
     },
     .probe = adxl345_probe,
     .remove = adxl345_remove,